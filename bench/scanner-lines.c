@@ -0,0 +1,204 @@
+/* This entire file is licensed under GNU General Public License v3.0
+ *
+ * Copyright 2025- sfwbar maintainers
+ */
+
+/* Parse recorded copies of /proc/stat and /proc/meminfo with the variables
+ * of the stock cpu and memory sources and report the heap allocations and
+ * time per pass. Allocations are counted by interposing malloc, so this
+ * only builds against glibc.
+ *
+ * The line reader must not allocate per line. The benchmark fails if a
+ * pass over /proc/meminfo repeated BENCH_REPEAT times allocates more than
+ * a pass over a single copy, when no variable matches any line */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include "scanner.h"
+#include "config/config.h"
+
+extern void *__libc_malloc ( size_t size );
+extern void *__libc_calloc ( size_t n, size_t size );
+extern void *__libc_realloc ( void *ptr, size_t size );
+
+#define BENCH_REPEAT 16
+
+static gint allocs;
+
+void *malloc ( size_t size )
+{
+  g_atomic_int_inc(&allocs);
+  return __libc_malloc(size);
+}
+
+void *calloc ( size_t n, size_t size )
+{
+  g_atomic_int_inc(&allocs);
+  return __libc_calloc(n, size);
+}
+
+void *realloc ( void *ptr, size_t size )
+{
+  g_atomic_int_inc(&allocs);
+  return __libc_realloc(ptr, size);
+}
+
+static ScanFile *bench_source ( const gchar *dir, const gchar *name,
+    const gchar *vars[][2], gint flag )
+{
+  ScanFile *file;
+  gint i;
+
+  file = scanner_file_new(SO_FILE, g_build_filename(dir, name, NULL), NULL,
+      0);
+  for(i=0; vars[i][0]; i++)
+    scanner_var_new((gchar *)vars[i][0], file, (gchar *)vars[i][1],
+        G_TOKEN_REGEX, flag);
+
+  return file;
+}
+
+/* average allocations per pass over a source, after a warm up pass */
+static gdouble bench_allocs ( ScanFile *file, gint passes )
+{
+  gint i, count;
+
+  scanner_file_glob(file);
+  count = g_atomic_int_get(&allocs);
+  for(i=0; i<passes; i++)
+    scanner_file_glob(file);
+
+  return (gdouble)(g_atomic_int_get(&allocs) - count) / passes;
+}
+
+/* write a data file repeated n times into dir as <name>-<n> */
+static gboolean bench_repeat ( const gchar *src, const gchar *dir,
+    const gchar *name, gint n )
+{
+  GString *data;
+  gchar *contents, *path, *fname;
+  gboolean result;
+  gint i;
+
+  path = g_build_filename(src, name, NULL);
+  result = g_file_get_contents(path, &contents, NULL, NULL);
+  g_free(path);
+  if(!result)
+    return FALSE;
+
+  data = g_string_new(NULL);
+  for(i=0; i<n; i++)
+    g_string_append(data, contents);
+  g_free(contents);
+
+  fname = g_strdup_printf("%s-%d", name, n);
+  path = g_build_filename(dir, fname, NULL);
+  result = g_file_set_contents(path, data->str, data->len, NULL);
+  g_string_free(data, TRUE);
+  g_free(fname);
+  g_free(path);
+
+  return result;
+}
+
+/* remove a file written by bench_repeat */
+static void bench_unlink ( const gchar *dir, const gchar *name, gint n )
+{
+  gchar *fname, *path;
+
+  fname = g_strdup_printf("%s-%d", name, n);
+  path = g_build_filename(dir, fname, NULL);
+  g_remove(path);
+  g_free(fname);
+  g_free(path);
+}
+
+gint main ( gint argc, gchar *argv[] )
+{
+  static const gchar *cpu[][2] = {
+    { "CpuUser", "^cpu [\t ]*([0-9]+)" },
+    { "CpuNice", "^cpu [\t ]*[0-9]+ ([0-9]+)" },
+    { "CpuSystem", "^cpu [\t ]*(?:[0-9]+ ){2}([0-9]+)" },
+    { "CpuIdle", "^cpu [\t ]*(?:[0-9]+ ){3}([0-9]+)" },
+    { NULL, NULL }
+  };
+  static const gchar *mem[][2] = {
+    { "MemTotal", "^MemTotal:[\t ]*([0-9]+)[\t ]" },
+    { "MemFree", "^MemFree:[\t ]*([0-9]+)[\t ]" },
+    { "MemCache", "^Cached:[\t ]*([0-9]+)[\t ]" },
+    { "MemBuff", "^Buffers:[\t ]*([0-9]+)[\t ]" },
+    { NULL, NULL }
+  };
+  static const gchar *miss_once[][2] = {
+    { "MissOnce", "^NoSuchField:[\t ]*([0-9]+)" },
+    { NULL, NULL }
+  };
+  static const gchar *miss_repeat[][2] = {
+    { "MissRepeat", "^NoSuchField:[\t ]*([0-9]+)" },
+    { NULL, NULL }
+  };
+  gdouble once, repeat;
+  gchar *tmp, *path;
+  ScanFile *stat, *meminfo;
+  gint64 start, elapsed;
+  gint i, passes, count;
+
+  if(argc < 2)
+  {
+    g_printerr("usage: %s <data dir> [passes]\n", argv[0]);
+    return 1;
+  }
+  passes = argc > 2? atoi(argv[2]) : 100000;
+
+  stat = bench_source(argv[1], "proc-stat", cpu, VT_SUM);
+  meminfo = bench_source(argv[1], "proc-meminfo", mem, VT_LAST);
+
+  /* the first pass builds the matchers and the line buffers */
+  scanner_file_glob(stat);
+  scanner_file_glob(meminfo);
+
+  count = g_atomic_int_get(&allocs);
+  start = g_get_monotonic_time();
+  for(i=0; i<passes; i++)
+  {
+    scanner_file_glob(stat);
+    scanner_file_glob(meminfo);
+  }
+  elapsed = g_get_monotonic_time() - start;
+  count = g_atomic_int_get(&allocs) - count;
+
+  g_print("passes: %d\n", passes);
+  g_print("allocations per pass: %.2f\n", (gdouble)count / passes);
+  g_print("time per pass: %.2f us\n", (gdouble)elapsed / passes);
+
+  /* the sources with no matches read copies in a directory of their own,
+   * so they don't share a source with the variables above */
+  if( !(tmp = g_dir_make_tmp("sfwbar-bench-XXXXXX", NULL)) ||
+      !bench_repeat(argv[1], tmp, "proc-meminfo", 1) ||
+      !bench_repeat(argv[1], tmp, "proc-meminfo", BENCH_REPEAT) )
+  {
+    g_printerr("unable to write copies of proc-meminfo\n");
+    return 1;
+  }
+  once = bench_allocs(bench_source(tmp, "proc-meminfo-1", miss_once,
+        VT_LAST), passes);
+  path = g_strdup_printf("proc-meminfo-%d", BENCH_REPEAT);
+  repeat = bench_allocs(bench_source(tmp, path, miss_repeat, VT_LAST),
+      passes);
+  g_free(path);
+  bench_unlink(tmp, "proc-meminfo", 1);
+  bench_unlink(tmp, "proc-meminfo", BENCH_REPEAT);
+  g_rmdir(tmp);
+  g_free(tmp);
+
+  g_print("allocations per pass, no matches, 1x: %.2f, %dx: %.2f\n", once,
+      BENCH_REPEAT, repeat);
+  if(repeat > once + 0.5)
+  {
+    g_printerr("allocations grow with the number of lines read\n");
+    return 1;
+  }
+
+  return 0;
+}
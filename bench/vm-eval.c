@@ -0,0 +1,132 @@
+/* This entire file is licensed under GNU General Public License v3.0
+ *
+ * Copyright 2025- sfwbar maintainers
+ */
+
+/* Evaluate a numeric and a string expression over the stock cpu source
+ * variables and report evaluations per second, first on one thread and
+ * then on several threads at once, each with its own expression caches.
+ * The third expression has constant sub-expressions, the size of the code
+ * of each expression shows what constant folding removed. The benchmark
+ * fails if a fully constant expression doesn't fold into one immediate */
+
+#include <glib.h>
+#include <stdlib.h>
+#include "scanner.h"
+#include "config/config.h"
+
+static const gchar *bench_exprs[] = {
+  "(CpuUser-CpuUser.pval)/(CpuUser+CpuNice+CpuSystem+CpuIdle-CpuUser.pval-"
+    "CpuNice.pval-CpuSystem.pval-CpuIdle.pval)",
+  "\"CPU: \" + Pad(Str(CpuUser*100/(CpuUser+CpuSystem+CpuIdle),1),6) + "
+    "\"% \" + If(CpuIdle>CpuUser,\"idle\",\"busy\")",
+  "CpuUser*(60*60*24)/(1024*1024) + If(1>2,CpuNice,CpuIdle)",
+  NULL
+};
+
+static const gchar *bench_const = "((2+3)*4-1)/(1024*1024)";
+
+static GBytes *bench_code[G_N_ELEMENTS(bench_exprs)];
+static gint bench_evals;
+
+static gpointer bench_thread ( gpointer data )
+{
+  expr_cache_t *expr[G_N_ELEMENTS(bench_exprs)];
+  gint i, j;
+
+  for(j=0; bench_code[j]; j++)
+  {
+    expr[j] = expr_cache_new();
+    expr[j]->code = g_bytes_ref(bench_code[j]);
+  }
+
+  for(i=0; i<bench_evals; i++)
+    for(j=0; bench_code[j]; j++)
+    {
+      expr[j]->eval = TRUE;
+      (void)expr_cache_eval(expr[j]);
+    }
+
+  for(j=0; bench_code[j]; j++)
+    expr_cache_free(expr[j]);
+
+  return NULL;
+}
+
+static void bench_run ( gint threads )
+{
+  GThread **thread;
+  gint64 start, elapsed;
+  gint i;
+
+  thread = g_malloc(sizeof(GThread *) * threads);
+  start = g_get_monotonic_time();
+  for(i=0; i<threads; i++)
+    thread[i] = g_thread_new("bench", bench_thread, NULL);
+  for(i=0; i<threads; i++)
+    g_thread_join(thread[i]);
+  elapsed = MAX(g_get_monotonic_time() - start, 1);
+  g_free(thread);
+
+  g_print("threads: %d, evaluations per second: %.0f\n", threads,
+      (gdouble)bench_evals * (G_N_ELEMENTS(bench_exprs) - 1) * threads *
+      G_USEC_PER_SEC / elapsed);
+}
+
+gint main ( gint argc, gchar *argv[] )
+{
+  static const gchar *cpu[][2] = {
+    { "CpuUser", "^cpu [\t ]*([0-9]+)" },
+    { "CpuNice", "^cpu [\t ]*[0-9]+ ([0-9]+)" },
+    { "CpuSystem", "^cpu [\t ]*(?:[0-9]+ ){2}([0-9]+)" },
+    { "CpuIdle", "^cpu [\t ]*(?:[0-9]+ ){3}([0-9]+)" },
+    { NULL, NULL }
+  };
+  ScanFile *file;
+  GBytes *code;
+  gint i, threads;
+
+  if(argc < 2)
+  {
+    g_printerr("usage: %s <data dir> [evaluations] [threads]\n", argv[0]);
+    return 1;
+  }
+  bench_evals = argc > 2? atoi(argv[2]) : 1000000;
+  threads = argc > 3? atoi(argv[3]) : g_get_num_processors();
+
+  config_init();
+  expr_lib_init();
+
+  file = scanner_file_new(SO_FILE,
+      g_build_filename(argv[1], "proc-stat", NULL), NULL, 0);
+  for(i=0; cpu[i][0]; i++)
+    scanner_var_new((gchar *)cpu[i][0], file, (gchar *)cpu[i][1],
+        G_TOKEN_REGEX, VT_SUM);
+  scanner_file_glob(file);
+
+  for(i=0; bench_exprs[i]; i++)
+  {
+    if( !(bench_code[i] = parser_expr_compile((gchar *)bench_exprs[i])) )
+    {
+      g_printerr("unable to compile: %s\n", bench_exprs[i]);
+      return 1;
+    }
+    g_print("expression %d: %zu bytes of code\n", i,
+        g_bytes_get_size(bench_code[i]));
+  }
+
+  /* a folded constant is a single immediate: opcode and value */
+  if( !(code = parser_expr_compile((gchar *)bench_const)) ||
+      g_bytes_get_size(code) != sizeof(value_t) + 1 )
+  {
+    g_printerr("constant expression not folded: %s\n", bench_const);
+    return 1;
+  }
+  g_bytes_unref(code);
+
+  bench_run(1);
+  if(threads > 1)
+    bench_run(threads);
+
+  return 0;
+}
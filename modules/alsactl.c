@@ -622,8 +622,8 @@ void alsa_activate ( void )
   vm_func_add("volume", alsa_func_volume, FALSE);
   vm_func_add("volumeinfo", alsa_func_volume_info, FALSE);
   vm_func_add("volumeconf", alsa_func_channel, FALSE);
-  vm_func_add("volumectl", alsa_action_volumectl, TRUE);
-  vm_func_add("volumeack", alsa_action_volumeack, TRUE);
+  vm_func_add("volumectl", alsa_action_volumectl, FALSE);
+  vm_func_add("volumeack", alsa_action_volumeack, FALSE);
   g_idle_add((GSourceFunc)alsa_source_subscribe_all, NULL);
 }
 
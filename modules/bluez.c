@@ -843,13 +843,13 @@ gboolean sfwbar_module_init ( void )
 
   vm_func_add("bluezget", bz_expr_get, FALSE);
   vm_func_add("bluezstate", bz_expr_state, FALSE);
-  vm_func_add("bluezack", bz_action_ack, TRUE);
-  vm_func_add("bluezackremoved", bz_action_ack_removed, TRUE);
-  vm_func_add("bluezscan", bz_action_scan, TRUE);
-  vm_func_add("bluezconnect", bz_action_connect, TRUE);
-  vm_func_add("bluezpair", bz_action_pair, TRUE);
-  vm_func_add("bluezdisconnect", bz_action_disconnect, TRUE);
-  vm_func_add("bluezremove", bz_action_remove, TRUE);
+  vm_func_add("bluezack", bz_action_ack, FALSE);
+  vm_func_add("bluezackremoved", bz_action_ack_removed, FALSE);
+  vm_func_add("bluezscan", bz_action_scan, FALSE);
+  vm_func_add("bluezconnect", bz_action_connect, FALSE);
+  vm_func_add("bluezpair", bz_action_pair, FALSE);
+  vm_func_add("bluezdisconnect", bz_action_disconnect, FALSE);
+  vm_func_add("bluezremove", bz_action_remove, FALSE);
 
   update_q.trigger = g_intern_static_string("bluez_updated");
   remove_q.trigger = g_intern_static_string("bluez_removed");
@@ -65,7 +65,7 @@ static value_t idle_inhibitor_action ( vm_t *vm, value_t p[], gint np )
 gboolean sfwbar_module_init ( void )
 {
   vm_func_add("idleinhibitstate", idle_inhibit_state, FALSE);
-  vm_func_add("setidleinhibitor", idle_inhibitor_action, TRUE);
+  vm_func_add("setidleinhibitor", idle_inhibitor_action, FALSE);
   idle_inhibit_manager = wayland_iface_register(
           zwp_idle_inhibit_manager_v1_interface.name, 1, 1,
           &zwp_idle_inhibit_manager_v1_interface);
@@ -248,8 +248,8 @@ static value_t mpd_set_passwd ( vm_t *vm, value_t p[], gint np )
 gboolean sfwbar_module_init ( void )
 {
   vm_func_add("mpd", mpd_expr_func, FALSE);
-  vm_func_add("mpdcommand", mpd_command, TRUE);
-  vm_func_add("mpdsetpassword", mpd_set_passwd, TRUE);
+  vm_func_add("mpdcommand", mpd_command, FALSE);
+  vm_func_add("mpdsetpassword", mpd_set_passwd, FALSE);
   if(mpd_connect(NULL))
     g_timeout_add (1000,(GSourceFunc )mpd_connect,NULL);
   return TRUE;
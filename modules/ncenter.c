@@ -620,11 +620,11 @@ gboolean sfwbar_module_init ( void )
   vm_func_add("notificationgroup", dn_group_func, FALSE);
   vm_func_add("notificationactivegroup", dn_active_group_func, FALSE);
   vm_func_add("notificationcount", dn_count_func, FALSE);
-  vm_func_add("notificationclose", dn_close_action, TRUE);
-  vm_func_add("notificationaction", dn_action_action, TRUE);
-  vm_func_add("notificationack", dn_ack_action, TRUE);
-  vm_func_add("notificationexpand", dn_expand_action, TRUE);
-  vm_func_add("notificationcollapse", dn_collapse_action, TRUE);
+  vm_func_add("notificationclose", dn_close_action, FALSE);
+  vm_func_add("notificationaction", dn_action_action, FALSE);
+  vm_func_add("notificationack", dn_ack_action, FALSE);
+  vm_func_add("notificationexpand", dn_expand_action, FALSE);
+  vm_func_add("notificationcollapse", dn_collapse_action, FALSE);
   update_q.trigger = g_intern_static_string("notification-updated");
   remove_q.trigger = g_intern_static_string("notification-removed");
 
@@ -751,8 +751,8 @@ static void pulse_activate ( void )
   vm_func_add("volume", pulse_volume_func, FALSE);
   vm_func_add("volumeinfo", pulse_volume_info_func, FALSE);
   vm_func_add("volumeconf", pulse_volume_conf_func, FALSE);
-  vm_func_add("volumectl", pulse_volume_ctl_action, TRUE);
-  vm_func_add("volumeack", pulse_volume_ack_action, TRUE);
+  vm_func_add("volumectl", pulse_volume_ctl_action, FALSE);
+  vm_func_add("volumeack", pulse_volume_ack_action, FALSE);
   pa_context_set_subscribe_callback(pctx, pulse_subscribe_cb, NULL);
   pulse_operation(pa_context_subscribe(pctx, PA_SUBSCRIPTION_MASK_SERVER |
         PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SINK_INPUT |
@@ -303,19 +303,14 @@ static value_t action_setbarvisibility ( vm_t *vm, value_t p[], gint np )
 static value_t action_setvalue ( vm_t *vm, value_t p[], gint np )
 {
   GtkWidget *widget;
-  guint8 *mark;
+  GBytes *code;
 
   vm_param_check_np_range(vm, np, 1, 2, "SetValue");
   vm_param_check_string(vm, p, 0, "SetValue");
 
-  if(!vm->pstack->len)
-    return value_na;
-
-  mark = vm->pstack->pdata[vm->pstack->len-1];
-
-  if( (widget = np==2?base_widget_from_id(value_get_string(p[0])):vm->widget) )
-    base_widget_set_value(widget,
-        g_bytes_new_take(g_memdup(mark, vm->ip - mark), vm->ip - mark));
+  if( (widget = np==2?base_widget_from_id(value_get_string(p[0])):vm->widget) &&
+      (code = vm_param_code(vm)) )
+    base_widget_set_value(widget, code);
 
   return value_na;
 }
@@ -323,19 +318,14 @@ static value_t action_setvalue ( vm_t *vm, value_t p[], gint np )
 static value_t action_setstyle ( vm_t *vm, value_t p[], gint np )
 {
   GtkWidget *widget;
-  guint8 *mark;
+  GBytes *code;
 
   vm_param_check_np_range(vm, np, 1, 2, "SetValue");
   vm_param_check_string(vm, p, 0, "SetValue");
 
-  if(!vm->pstack->len)
-    return value_na;
-
-  mark = vm->pstack->pdata[vm->pstack->len-1];
-
-  if( (widget = np==2?base_widget_from_id(value_get_string(p[0])):vm->widget) )
-    base_widget_set_style(widget,
-        g_bytes_new_take(g_memdup(mark, vm->ip - mark), vm->ip - mark));
+  if( (widget = np==2?base_widget_from_id(value_get_string(p[0])):vm->widget) &&
+      (code = vm_param_code(vm)) )
+    base_widget_set_style(widget, code);
 
   return value_na;
 }
@@ -343,19 +333,14 @@ static value_t action_setstyle ( vm_t *vm, value_t p[], gint np )
 static value_t action_settooltip ( vm_t *vm, value_t p[], gint np )
 {
   GtkWidget *widget;
-  guint8 *mark;
+  GBytes *code;
 
   vm_param_check_np_range(vm, np, 1, 2, "SetValue");
   vm_param_check_string(vm, p, 0, "SetValue");
 
-  if(!vm->pstack->len)
-    return value_na;
-
-  mark = vm->pstack->pdata[vm->pstack->len-1];
-
-  if( (widget = np==2?base_widget_from_id(value_get_string(p[0])):vm->widget) )
-    base_widget_set_tooltip(widget,
-        g_bytes_new_take(g_memdup(mark, vm->ip - mark), vm->ip - mark));
+  if( (widget = np==2?base_widget_from_id(value_get_string(p[0])):vm->widget) &&
+      (code = vm_param_code(vm)) )
+    base_widget_set_tooltip(widget, code);
 
   return value_na;
 }
@@ -592,40 +577,40 @@ static value_t action_check_state ( vm_t *vm, value_t p[], gint np )
 
 void action_lib_init ( void )
 {
-  vm_func_add("exec", action_exec_impl, TRUE);
-  vm_func_add("function", action_function, TRUE);
-  vm_func_add("piperead", action_piperead, TRUE);
-  vm_func_add("menuclear", action_menuclear, TRUE);
-  vm_func_add("menuitemclear", action_menuitemclear, TRUE);
-  vm_func_add("menu", action_menu, TRUE);
-  vm_func_add("mpdcmd", action_mpd, TRUE);
-  vm_func_add("config", action_config, TRUE);
-  vm_func_add("mapicon", action_map_icon, TRUE);
-  vm_func_add("popup", action_popup, TRUE);
-  vm_func_add("setmonitor", action_setmonitor, TRUE);
-  vm_func_add("setlayer", action_setlayer, TRUE);
-  vm_func_add("setmirror", action_setmirror, TRUE);
-  vm_func_add("setbarsize", action_setbarsize, TRUE);
-  vm_func_add("setbarmargin", action_setbarmargin, TRUE);
-  vm_func_add("setbarid", action_setbarid, TRUE);
-  vm_func_add("setbarsensor", action_setbarsensor, TRUE);
-  vm_func_add("setbarvisibility", action_setbarvisibility, TRUE);
-  vm_func_add("setexclusivezone", action_setexclusivezone, TRUE);
-  vm_func_add("userstate", action_userstate, TRUE);
-  vm_func_add("setvalue", action_setvalue, TRUE);
-  vm_func_add("setstyle", action_setstyle, TRUE);
-  vm_func_add("settooltip", action_settooltip, TRUE);
-  vm_func_add("focus", action_focus, TRUE);
-  vm_func_add("close", action_close, TRUE);
-  vm_func_add("minimize", action_minimize, TRUE);
-  vm_func_add("maximize", action_maximize, TRUE);
-  vm_func_add("unminimize", action_unminimize, TRUE);
-  vm_func_add("unmaximize", action_unmaximize, TRUE);
-  vm_func_add("clientsend", action_client_send, TRUE);
-  vm_func_add("eval", action_eval, TRUE);
-  vm_func_add("switcherevent", action_switcher, TRUE);
-  vm_func_add("workspaceactivate", action_workspace_activate, TRUE);
-  vm_func_add("taskbaritemdefault", action_taskbar_item, TRUE);
-  vm_func_add("clearwidget", action_clear_widget, TRUE);
+  vm_func_add("exec", action_exec_impl, FALSE);
+  vm_func_add("function", action_function, FALSE);
+  vm_func_add("piperead", action_piperead, FALSE);
+  vm_func_add("menuclear", action_menuclear, FALSE);
+  vm_func_add("menuitemclear", action_menuitemclear, FALSE);
+  vm_func_add("menu", action_menu, FALSE);
+  vm_func_add("mpdcmd", action_mpd, FALSE);
+  vm_func_add("config", action_config, FALSE);
+  vm_func_add("mapicon", action_map_icon, FALSE);
+  vm_func_add("popup", action_popup, FALSE);
+  vm_func_add("setmonitor", action_setmonitor, FALSE);
+  vm_func_add("setlayer", action_setlayer, FALSE);
+  vm_func_add("setmirror", action_setmirror, FALSE);
+  vm_func_add("setbarsize", action_setbarsize, FALSE);
+  vm_func_add("setbarmargin", action_setbarmargin, FALSE);
+  vm_func_add("setbarid", action_setbarid, FALSE);
+  vm_func_add("setbarsensor", action_setbarsensor, FALSE);
+  vm_func_add("setbarvisibility", action_setbarvisibility, FALSE);
+  vm_func_add("setexclusivezone", action_setexclusivezone, FALSE);
+  vm_func_add("userstate", action_userstate, FALSE);
+  vm_func_add("setvalue", action_setvalue, FALSE);
+  vm_func_add("setstyle", action_setstyle, FALSE);
+  vm_func_add("settooltip", action_settooltip, FALSE);
+  vm_func_add("focus", action_focus, FALSE);
+  vm_func_add("close", action_close, FALSE);
+  vm_func_add("minimize", action_minimize, FALSE);
+  vm_func_add("maximize", action_maximize, FALSE);
+  vm_func_add("unminimize", action_unminimize, FALSE);
+  vm_func_add("unmaximize", action_unmaximize, FALSE);
+  vm_func_add("clientsend", action_client_send, FALSE);
+  vm_func_add("eval", action_eval, FALSE);
+  vm_func_add("switcherevent", action_switcher, FALSE);
+  vm_func_add("workspaceactivate", action_workspace_activate, FALSE);
+  vm_func_add("taskbaritemdefault", action_taskbar_item, FALSE);
+  vm_func_add("clearwidget", action_clear_widget, FALSE);
   vm_func_add("checkstate", action_check_state, FALSE);
 }
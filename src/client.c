@@ -43,8 +43,9 @@ gboolean client_event ( GIOChannel *chan, GIOCondition cond, gpointer data )
       cstat = client->consume(client, &size);
     else
     {
-      g_list_foreach(client->file->vars,(GFunc)scanner_var_reset,NULL);
-      cstat = scanner_file_update( chan, client->file, &size );
+      g_ptr_array_foreach(client->file->vars,(GFunc)scanner_var_reset,NULL);
+      cstat = scanner_file_update(g_io_channel_unix_get_fd(chan),
+          client->file, &size);
     }
     if(cstat == G_IO_STATUS_ERROR || !size )
     {
@@ -75,6 +75,7 @@ enum {
   G_TOKEN_THEME,
   G_TOKEN_ICON_THEME,
   G_TOKEN_DISOWNMINIMIZED,
+  G_TOKEN_TIMERSLACK,
   G_TOKEN_END,
   G_TOKEN_FILE,
   G_TOKEN_EXEC,
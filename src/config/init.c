@@ -93,6 +93,7 @@ void config_init ( void )
   config_add_key(config_var_types, "Product", VT_PROD);
   config_add_key(config_var_types, "Last", VT_LAST);
   config_add_key(config_var_types, "FIrst", VT_FIRST);
+  config_add_key(config_var_types, "Array", VT_ARRAY);
 
   config_act_cond = g_hash_table_new((GHashFunc)str_nhash,
       (GEqualFunc)str_nequal);
@@ -121,6 +122,7 @@ void config_init ( void )
   config_add_key(config_toplevel_keys, "IconTheme", G_TOKEN_ICON_THEME);
   config_add_key(config_toplevel_keys, "DisownMinimized",
       G_TOKEN_DISOWNMINIMIZED);
+  config_add_key(config_toplevel_keys, "TimerSlack", G_TOKEN_TIMERSLACK);
   config_add_key(config_toplevel_keys, "Function", G_TOKEN_FUNCTION);
   config_add_key(config_toplevel_keys, "Set", G_TOKEN_SET);
   config_add_key(config_toplevel_keys, "MenuClear", G_TOKEN_MENUCLEAR);
@@ -161,6 +163,9 @@ void config_init ( void )
       (GEqualFunc)str_nequal);
   config_add_key(config_scanner_flags, "NoGlob", VF_NOGLOB);
   config_add_key(config_scanner_flags, "CheckTime", VF_CHTIME);
+  config_add_key(config_scanner_flags, "Persistent", VF_PERSIST);
+  config_add_key(config_scanner_flags, "Watch", VF_WATCH);
+  config_add_key(config_scanner_flags, "Kill", VF_KILL);
 
   config_filter_keys = g_hash_table_new((GHashFunc)str_nhash,
       (GEqualFunc)str_nequal);
@@ -287,6 +292,31 @@ GtkWidget *config_parse_data ( gchar *fname, gchar *data, GtkWidget *container )
   return w;
 }
 
+GBytes *parser_expr_compile ( gchar *expr )
+{
+  GScanner *scanner;
+  GByteArray *code;
+  gboolean result;
+
+  if(!expr)
+    return NULL;
+
+  scanner = g_scanner_new(&scanner_config);
+  scanner->msg_handler = config_log_error;
+  scanner->max_parse_errors = FALSE;
+  scanner->input_name = "expression";
+  g_scanner_input_text(scanner, expr, strlen(expr));
+
+  code = g_byte_array_new();
+  result = parser_expr_parse(scanner, code) && !scanner->max_parse_errors;
+  g_scanner_destroy(scanner);
+
+  if(result)
+    return g_byte_array_free_to_bytes(code);
+  g_byte_array_free(code, TRUE);
+  return NULL;
+}
+
 void config_string ( gchar *string )
 {
   gchar *conf;
@@ -78,16 +78,40 @@ static void config_var ( GScanner *scanner, ScanFile *file )
   g_free(pattern);
 }
 
-static gboolean config_source_flags ( GScanner *scanner, gint *flags )
+typedef struct {
+  gint source;
+  gint flags;
+  gchar *trigger;
+  gint64 interval;
+} config_source_opts_t;
+
+/* a number is the glob cache interval of a File source and the timeout of
+ * an Exec source, the flags only apply to the source they affect */
+static gboolean config_source_flags ( GScanner *scanner,
+    config_source_opts_t *opts )
 {
-  gint flag;
+  gint flag, valid;
+
+  valid = opts->source == SO_EXEC? VF_KILL :
+    VF_CHTIME | VF_NOGLOB | VF_PERSIST | VF_WATCH;
 
   while (config_check_and_consume(scanner, ','))
   {
     g_scanner_get_next_token(scanner);
 
-    if( (flag = config_lookup_key(scanner, config_scanner_flags)) )
-      *flags |= flag;
+    if(scanner->token == G_TOKEN_STRING && !opts->trigger)
+      opts->trigger = g_strdup(scanner->value.v_string);
+    else if(scanner->token == G_TOKEN_FLOAT && scanner->value.v_float >= 0)
+      opts->interval = scanner->value.v_float;
+    else if( (flag = config_lookup_key(scanner, config_scanner_flags)) )
+    {
+      if(flag & valid)
+        opts->flags |= flag;
+      else
+        g_scanner_error(scanner, "flag %s is not valid for %s source",
+            scanner->value.v_identifier,
+            opts->source == SO_EXEC? "an Exec" : "a File");
+    }
     else
         g_scanner_error(scanner, "invalid flag in source");
   }
@@ -98,18 +122,21 @@ static ScanFile *config_source ( GScanner *scanner, gint source )
 {
   ScanFile *file;
   gchar *fname = NULL, *trigger = NULL;
-  gint flags = 0;
+  config_source_opts_t opts = { .source = source, .flags = 0,
+    .trigger = NULL, .interval = -1 };
 
   switch(source)
   {
     case SO_FILE:
+    case SO_EXEC:
       config_parse_sequence(scanner,
           SEQ_REQ, '(', NULL, NULL, "Missing '(' after source",
           SEQ_REQ, G_TOKEN_STRING, NULL, &fname, "Missing file in a source",
-          SEQ_OPT, -2, (parse_func)config_source_flags, &flags, NULL,
+          SEQ_OPT, -2, (parse_func)config_source_flags, &opts, NULL,
           SEQ_REQ, ')', NULL, NULL, "Missing ')' after source",
           SEQ_REQ, '{', NULL, NULL, "Missing '{' after source",
           SEQ_END);
+      trigger = opts.trigger;
       break;
     case SO_CLIENT:
       config_parse_sequence(scanner,
@@ -138,7 +165,11 @@ static ScanFile *config_source ( GScanner *scanner, gint source )
     return NULL;
   }
 
-  file = scanner_file_new(source, fname, trigger, flags);
+  file = scanner_file_new(source, fname, trigger, opts.flags);
+  if(source == SO_EXEC)
+    file->timeout = MAX(opts.interval, 0);
+  else if(opts.interval >= 0)
+    file->glob_interval = opts.interval * 1000;
   while(!config_is_section_end(scanner))
     config_var(scanner, file);
 
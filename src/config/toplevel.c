@@ -350,6 +350,10 @@ GtkWidget *config_parse_toplevel ( GScanner *scanner, GtkWidget *container )
         wintree_set_disown(config_assign_boolean(scanner, FALSE,
               "DisownMinimized"));
         break;
+      case G_TOKEN_TIMERSLACK:
+        base_widget_scanner_set_slack(
+            1000*config_assign_number(scanner, "TimerSlack"));
+        break;
       default:
         g_scanner_error(scanner,"Unexpected toplevel token");
         break;
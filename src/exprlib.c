@@ -512,9 +512,11 @@ static value_t expr_array_build ( vm_t *vm, value_t p[], gint np )
   array = g_array_new(FALSE, FALSE, sizeof(value_t));
   g_array_set_clear_func(array, (GDestroyNotify)value_free);
 
+  /* the array may outlive the evaluation (i.e. in a memo or an expression
+   * cache), so it doesn't borrow strings from the code or a snapshot */
   for(i=0; i<np; i++)
   {
-    v1 = value_dup(p[i]);
+    v1 = value_persist(value_dup(p[i]));
     g_array_append_val(array, v1);
   }
 
@@ -555,7 +557,7 @@ static value_t expr_array_assign ( vm_t *vm, value_t p[], gint np )
 
   v1 = &g_array_index(arr, value_t, n);
   value_free(*v1);
-  *v1 = value_dup(p[2]);
+  *v1 = value_persist(value_dup(p[2]));
 
   return value_new_array(arr);
 }
@@ -613,7 +615,7 @@ void expr_lib_init ( void )
   vm_func_add("mid", expr_lib_mid, TRUE);
   vm_func_add("pad", expr_lib_pad, TRUE);
   vm_func_add("extract", expr_lib_extract, TRUE);
-  vm_func_add("ident", expr_ident, TRUE);
+  vm_func_add("ident", expr_ident, FALSE);
   vm_func_add("replace", expr_lib_replace, TRUE);
   vm_func_add("replaceall", expr_lib_replace_all, TRUE);
   vm_func_add("map", expr_lib_map, TRUE);
@@ -636,7 +638,7 @@ void expr_lib_init ( void )
   vm_func_add("windowinfo", expr_lib_window_info, FALSE);
   vm_func_add("read", expr_lib_read, FALSE);
   vm_func_add("interfaceprovider", expr_iface_provider, FALSE);
-  vm_func_add("gt", expr_gettext, FALSE);
+  vm_func_add("gt", expr_gettext, TRUE);
   vm_func_add("arraybuild", expr_array_build, FALSE);
   vm_func_add("arrayindex", expr_array_index, FALSE);
   vm_func_add("arrayassign", expr_array_assign, FALSE);
@@ -219,9 +219,16 @@ static void bar_style_updated ( GtkWidget *self )
 static void bar_map ( GtkWidget *self )
 {
   GTK_WIDGET_CLASS(bar_parent_class)->map(self);
+  base_widget_scanner_window_mapped(TRUE);
   bar_style_updated(self);
 }
 
+static void bar_unmap ( GtkWidget *self )
+{
+  base_widget_scanner_window_mapped(FALSE);
+  GTK_WIDGET_CLASS(bar_parent_class)->unmap(self);
+}
+
 static void bar_init ( Bar *self )
 {
 }
@@ -233,6 +240,7 @@ static void bar_class_init ( BarClass *kclass )
   GTK_WIDGET_CLASS(kclass)->leave_notify_event = bar_leave_notify_event;
   GTK_WIDGET_CLASS(kclass)->style_updated = bar_style_updated;
   GTK_WIDGET_CLASS(kclass)->map = bar_map;
+  GTK_WIDGET_CLASS(kclass)->unmap = bar_unmap;
   g_unix_signal_add(SIGUSR2,(GSourceFunc)bar_visibility_toggle_all,NULL);
 }
 
@@ -20,9 +20,114 @@ G_DEFINE_TYPE_WITH_CODE (BaseWidget, base_widget, GTK_TYPE_EVENT_BOX,
 
 static GHashTable *base_widget_id_map;
 static GList *widgets_scan;
+static GPtrArray *widgets_sched;
 static GMutex widget_mutex;
+static GHashTable *widgets_batch;
+static GMutex batch_mutex;
+static gint64 widgets_slack;
+static gint widgets_windows;
+static gint widgets_suspended;
 static gint64 base_widget_default_id = 0;
 
+enum {
+  BASE_WIDGET_BATCH_VALUE = 1,
+  BASE_WIDGET_BATCH_STYLE = 2
+};
+
+/* polled widgets are kept in a min-heap ordered by next_poll, each widget
+ * stores its position in the heap (or -1) in sched_index. The heap is
+ * protected by widget_mutex */
+
+static gint64 base_widget_sched_deadline ( guint i )
+{
+  BaseWidgetPrivate *priv;
+
+  priv = base_widget_get_instance_private(
+      BASE_WIDGET(g_ptr_array_index(widgets_sched, i)));
+  return priv->next_poll;
+}
+
+static void base_widget_sched_set ( guint i, GtkWidget *self )
+{
+  BaseWidgetPrivate *priv;
+
+  priv = base_widget_get_instance_private(BASE_WIDGET(self));
+  g_ptr_array_index(widgets_sched, i) = self;
+  priv->sched_index = i;
+}
+
+static void base_widget_sched_swap ( guint i, guint j )
+{
+  GtkWidget *tmp;
+
+  tmp = g_ptr_array_index(widgets_sched, i);
+  base_widget_sched_set(i, g_ptr_array_index(widgets_sched, j));
+  base_widget_sched_set(j, tmp);
+}
+
+static void base_widget_sched_sift ( guint i )
+{
+  guint c;
+
+  while(i>0 && base_widget_sched_deadline(i) <
+      base_widget_sched_deadline((i-1)/2))
+  {
+    base_widget_sched_swap(i, (i-1)/2);
+    i = (i-1)/2;
+  }
+
+  while( (c = 2*i+1) < widgets_sched->len )
+  {
+    if(c+1 < widgets_sched->len && base_widget_sched_deadline(c+1) <
+        base_widget_sched_deadline(c))
+      c++;
+    if(base_widget_sched_deadline(i) <= base_widget_sched_deadline(c))
+      break;
+    base_widget_sched_swap(i, c);
+    i = c;
+  }
+}
+
+static void base_widget_unschedule ( GtkWidget *self )
+{
+  BaseWidgetPrivate *priv;
+  guint i;
+
+  priv = base_widget_get_instance_private(BASE_WIDGET(self));
+  if(priv->sched_index < 0)
+    return;
+
+  i = priv->sched_index;
+  priv->sched_index = -1;
+  if(i < widgets_sched->len-1)
+  {
+    base_widget_sched_set(i, g_ptr_array_index(widgets_sched,
+          widgets_sched->len-1));
+    g_ptr_array_set_size(widgets_sched, widgets_sched->len-1);
+    base_widget_sched_sift(i);
+  }
+  else
+    g_ptr_array_set_size(widgets_sched, widgets_sched->len-1);
+}
+
+/* queue a widget at its next_poll. Widgets without polled sources are left
+ * out until a change is pushed to one of their expressions */
+static void base_widget_schedule ( GtkWidget *self )
+{
+  BaseWidgetPrivate *priv;
+
+  priv = base_widget_get_instance_private(BASE_WIDGET(self));
+  if(priv->sched_index >= 0 ||
+      base_widget_get_next_poll(self) == G_MAXINT64)
+    return;
+
+  if(!widgets_sched)
+    widgets_sched = g_ptr_array_new();
+  g_ptr_array_add(widgets_sched, self);
+  base_widget_sched_set(widgets_sched->len-1, self);
+  base_widget_sched_sift(widgets_sched->len-1);
+}
+
 static void base_widget_attachment_free ( base_widget_attachment_t *attach )
 {
   if(!attach)
@@ -55,9 +160,17 @@ static void base_widget_destroy ( GtkWidget *self )
   trigger_remove((gchar *)(priv->trigger),
       (GSourceFunc)base_widget_trigger_cb, self);
   priv->trigger = NULL;
+  /* the scanner thread only takes queued expressions under widget_mutex */
   g_mutex_lock(&widget_mutex);
   widgets_scan = g_list_remove(widgets_scan, self);
+  base_widget_unschedule(self);
+  expr_dep_remove(priv->value);
+  expr_dep_remove(priv->style);
   g_mutex_unlock(&widget_mutex);
+  g_mutex_lock(&batch_mutex);
+  if(widgets_batch)
+    g_hash_table_remove(widgets_batch, self);
+  g_mutex_unlock(&batch_mutex);
 
   if(priv->mirror_parent)
   {
@@ -330,6 +443,7 @@ static void base_widget_init ( BaseWidget *self )
   priv->style = expr_cache_new();
   priv->tooltip = expr_cache_new();
   priv->interval = 1000000;
+  priv->sched_index = -1;
   priv->dir = GTK_POS_RIGHT;
   priv->rect.x = -1;
   priv->rect.y = -1;
@@ -389,9 +503,13 @@ void base_widget_set_local_state ( GtkWidget *self, gboolean state )
   {
     if(!g_list_find(widgets_scan, self))
       widgets_scan = g_list_append(widgets_scan, self);
+    base_widget_schedule(self);
   }
   else
+  {
     widgets_scan = g_list_remove(widgets_scan, self);
+    base_widget_unschedule(self);
+  }
   g_mutex_unlock(&widget_mutex);
 
   if(state)
@@ -500,6 +618,7 @@ void base_widget_set_value ( GtkWidget *self, GBytes *code )
   g_bytes_unref(priv->value->code);
   priv->value->code = code;
   priv->value->widget = self;
+  priv->value->queue = TRUE;
   priv->value->eval = !!code;
 
   if(expr_cache_eval(priv->value) || priv->always_update)
@@ -508,6 +627,7 @@ void base_widget_set_value ( GtkWidget *self, GBytes *code )
   g_mutex_lock(&widget_mutex);
   if(!g_list_find(widgets_scan,self))
     widgets_scan = g_list_append(widgets_scan,self);
+  base_widget_schedule(self);
   g_mutex_unlock(&widget_mutex);
 }
 
@@ -522,6 +642,7 @@ void base_widget_set_style ( GtkWidget *self, GBytes *code )
   g_bytes_unref(priv->style->code);
   priv->style->code = code;
   priv->style->widget = self;
+  priv->style->queue = TRUE;
   priv->style->eval = !!code;
 
   if(expr_cache_eval(priv->style))
@@ -530,6 +651,7 @@ void base_widget_set_style ( GtkWidget *self, GBytes *code )
   g_mutex_lock(&widget_mutex);
   if(!g_list_find(widgets_scan, self))
     widgets_scan = g_list_append(widgets_scan, self);
+  base_widget_schedule(self);
   g_mutex_unlock(&widget_mutex);
 }
 
@@ -551,6 +673,7 @@ void base_widget_set_style_static ( GtkWidget *self, gchar *style )
   g_mutex_lock(&widget_mutex);
   if(!g_list_find(widgets_scan, self))
     widgets_scan = g_list_append(widgets_scan, self);
+  base_widget_schedule(self);
   g_mutex_unlock(&widget_mutex);
 }
 
@@ -613,7 +736,12 @@ void base_widget_set_interval ( GtkWidget *self, gint64 interval )
   g_return_if_fail(IS_BASE_WIDGET(self));
   priv = base_widget_get_instance_private(BASE_WIDGET(self));
 
+  g_mutex_lock(&widget_mutex);
+  base_widget_unschedule(self);
   priv->interval = interval;
+  if(g_list_find(widgets_scan, self))
+    base_widget_schedule(self);
+  g_mutex_unlock(&widget_mutex);
 }
 
 void base_widget_set_state ( GtkWidget *self, guint16 mask, gboolean state )
@@ -729,11 +857,14 @@ void base_widget_set_next_poll ( GtkWidget *self, gint64 ctime )
   g_return_if_fail(IS_BASE_WIDGET(self));
   priv = base_widget_get_instance_private(BASE_WIDGET(self));
 
-  if(priv->trigger)
+  if(priv->trigger || !priv->interval)
     return;
 
-  while(priv->next_poll <= ctime)
-    priv->next_poll += priv->interval;
+  /* align deadlines to multiples of the interval, so widgets polled at
+   * the same interval share a wakeup */
+  priv->next_poll = (ctime / priv->interval + 1) * priv->interval;
+  if(priv->sched_index >= 0)
+    base_widget_sched_sift(priv->sched_index);
 }
 
 gint64 base_widget_get_next_poll ( GtkWidget *self )
@@ -746,7 +877,10 @@ gint64 base_widget_get_next_poll ( GtkWidget *self )
   if(priv->trigger || !priv->interval)
     return G_MAXINT64;
 
-  if(!priv->value->eval && !priv->style->eval)
+  /* widgets reading polled sources are still scheduled to refresh them,
+   * but their expressions are only evaluated once a change is pushed */
+  if(!priv->value->eval && !priv->style->eval && !priv->value->sources &&
+      !priv->style->sources)
     return G_MAXINT64;
 
   return priv->next_poll;
@@ -917,40 +1051,164 @@ GtkWidget *base_widget_get_mirror_parent ( GtkWidget *self )
     return self;
 }
 
+/* apply all updates queued by the scanner thread in one main loop
+ * dispatch, ahead of the redraw, so a tick results in a single relayout */
+static gboolean base_widget_batch_apply ( gpointer data )
+{
+  GHashTableIter hiter;
+  GHashTable *batch;
+  GtkWidget *self;
+  gpointer flags;
+
+  g_mutex_lock(&batch_mutex);
+  batch = g_steal_pointer(&widgets_batch);
+  g_mutex_unlock(&batch_mutex);
+
+  if(!batch)
+    return FALSE;
+
+  g_hash_table_iter_init(&hiter, batch);
+  while(g_hash_table_iter_next(&hiter, (gpointer *)&self, &flags))
+  {
+    if(GPOINTER_TO_INT(flags) & BASE_WIDGET_BATCH_VALUE)
+      base_widget_update_value(self);
+    if(GPOINTER_TO_INT(flags) & BASE_WIDGET_BATCH_STYLE)
+      base_widget_style(self);
+  }
+  g_hash_table_unref(batch);
+
+  return FALSE;
+}
+
+/* queue an update, repeated updates to a widget are merged and a single
+ * source is posted to the main loop for the whole batch */
+static void base_widget_batch_add ( GtkWidget *self, gint flags,
+    GMainContext *gmc )
+{
+  GSource *source;
+
+  g_mutex_lock(&batch_mutex);
+  if(!widgets_batch)
+  {
+    widgets_batch = g_hash_table_new(g_direct_hash, g_direct_equal);
+    source = g_idle_source_new();
+    g_source_set_priority(source, G_PRIORITY_HIGH_IDLE + 10);
+    g_source_set_callback(source, base_widget_batch_apply, NULL, NULL);
+    g_source_attach(source, gmc);
+    g_source_unref(source);
+  }
+  flags |= GPOINTER_TO_INT(g_hash_table_lookup(widgets_batch, self));
+  g_hash_table_insert(widgets_batch, self, GINT_TO_POINTER(flags));
+  g_mutex_unlock(&batch_mutex);
+}
+
+/* round scanner wakeups up to a multiple of slack, so deadlines falling
+ * within the same slot are served by a single wakeup */
+void base_widget_scanner_set_slack ( gint64 slack )
+{
+  g_mutex_lock(&widget_mutex);
+  widgets_slack = MAX(slack, 0);
+  g_mutex_unlock(&widget_mutex);
+}
+
+/* track windows hosting widgets, the scanner is suspended while none of
+ * them are mapped */
+void base_widget_scanner_window_mapped ( gboolean mapped )
+{
+  widgets_windows += mapped? 1 : -1;
+  g_atomic_int_set(&widgets_suspended, widgets_windows <= 0);
+  if(mapped && widgets_windows == 1)
+    expr_dep_notify();
+}
+
+static void base_widget_scanner_eval ( GtkWidget *self, GMainContext *gmc )
+{
+  BaseWidgetPrivate *priv;
+
+  priv = base_widget_get_instance_private(BASE_WIDGET(self));
+  if(expr_cache_eval(priv->value) || priv->always_update)
+    base_widget_batch_add(self, BASE_WIDGET_BATCH_VALUE, gmc);
+  if(expr_cache_eval(priv->style))
+    base_widget_batch_add(self, BASE_WIDGET_BATCH_STYLE, gmc);
+}
+
 gpointer base_widget_scanner_thread ( GMainContext *gmc )
 {
   BaseWidgetPrivate *priv;
-  GList *iter;
+  GList *iter, *files, *due;
   gint64 timer, ctime;
+  expr_cache_t *expr;
 
+  expr_dep_mute(TRUE);
   while ( TRUE )
   {
-    scanner_invalidate();
-    module_invalidate_all();
-    timer = G_MAXINT64;
+    if(g_atomic_int_get(&widgets_suspended))
+    {
+      (void)expr_dep_wait(G_MAXINT64);
+      continue;
+    }
+
     ctime = g_get_monotonic_time();
    
     g_mutex_lock(&widget_mutex);
-    for(iter=widgets_scan; iter!=NULL; iter=g_list_next(iter))
+    due = NULL;
+    while(widgets_sched && widgets_sched->len &&
+        base_widget_sched_deadline(0) <= ctime)
+    {
+      due = g_list_prepend(due, g_ptr_array_index(widgets_sched, 0));
+      base_widget_unschedule(due->data);
+    }
+
+    /* only widgets due for a poll start a new epoch and refresh (or spawn)
+     * their sources */
+    if(due)
+    {
+      scanner_invalidate();
+      module_invalidate_all();
+    }
+    files = NULL;
+    for(iter=due; iter!=NULL; iter=g_list_next(iter))
     {
       priv = base_widget_get_instance_private(BASE_WIDGET(iter->data));
-      if(base_widget_get_next_poll(iter->data)<=ctime)
+      files = scanner_expr_sources(priv->value, files);
+      files = scanner_expr_sources(priv->style, files);
+    }
+    scanner_file_refresh(files);
+    g_list_free(files);
+
+    for(iter=due; iter!=NULL; iter=g_list_next(iter))
+    {
+      base_widget_scanner_eval(iter->data, gmc);
+      base_widget_set_next_poll(iter->data, ctime);
+      base_widget_schedule(iter->data);
+    }
+    g_list_free(due);
+
+    /* widgets with a pushed change are evaluated against the published
+     * values and keep their place in the schedule. The scanner thread
+     * doesn't wake itself, so the queue is drained until changes pushed by
+     * these evaluations (i.e. through a Set variable) settle. A widget that
+     * picked up polled sources (from a Set variable) is scheduled */
+    scanner_hold(TRUE);
+    while( (expr = expr_dep_next()) )
+    {
+      priv = base_widget_get_instance_private(BASE_WIDGET(expr->widget));
+      if(!priv->trigger && priv->interval && g_atomic_int_get(&expr->pushed))
       {
-        if(expr_cache_eval(priv->value) || priv->always_update)
-          g_main_context_invoke(gmc,(GSourceFunc)base_widget_update_value,
-              iter->data);
-        if(expr_cache_eval(priv->style))
-          g_main_context_invoke(gmc, (GSourceFunc)base_widget_style,
-              iter->data);
-        base_widget_set_next_poll(iter->data,ctime);
+        base_widget_scanner_eval(expr->widget, gmc);
+        base_widget_schedule(expr->widget);
       }
-      timer = MIN(timer, base_widget_get_next_poll(iter->data));
     }
+    scanner_hold(FALSE);
+
+    timer = (widgets_sched && widgets_sched->len)?
+      base_widget_sched_deadline(0) : G_MAXINT64;
+    if(widgets_slack && timer != G_MAXINT64)
+      timer = (timer + widgets_slack - 1) / widgets_slack * widgets_slack;
     g_mutex_unlock(&widget_mutex);
 
-    timer -= g_get_monotonic_time();
-    if(timer>0)
-      g_usleep(timer);
+    if(timer > g_get_monotonic_time())
+      (void)expr_dep_wait(timer);
   }
 }
 
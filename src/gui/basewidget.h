@@ -54,6 +54,7 @@ struct _BaseWidgetPrivate
   guint maxw, maxh;
   const gchar *trigger;
   gint64 next_poll;
+  gint sched_index;
   gint dir;
   gboolean always_update;
   gboolean local_state;
@@ -100,6 +101,8 @@ GtkWidget *base_widget_from_id ( gchar *id );
 gchar *base_widget_get_value ( GtkWidget *self );
 GBytes *base_widget_get_action ( GtkWidget *self, gint, GdkModifierType );
 gpointer base_widget_scanner_thread ( GMainContext *gmc );
+void base_widget_scanner_set_slack ( gint64 slack );
+void base_widget_scanner_window_mapped ( gboolean mapped );
 void base_widget_set_css ( GtkWidget *widget, gchar *css );
 //gboolean base_widget_emit_trigger ( const gchar *trigger );
 void base_widget_autoexec ( GtkWidget *self, gpointer data );
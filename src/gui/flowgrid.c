@@ -51,6 +51,9 @@ static void flow_grid_destroy( GtkWidget *self )
   g_return_if_fail(IS_FLOW_GRID(self));
   priv = flow_grid_get_instance_private(FLOW_GRID(self));
 
+  if(priv->update_h)
+    g_source_remove(priv->update_h);
+  priv->update_h = 0;
   g_clear_pointer(&priv->dnd_target, gtk_target_entry_free);
   g_list_free_full(g_steal_pointer(&priv->children),
       (GDestroyNotify)gtk_widget_destroy);
@@ -118,6 +121,43 @@ static void flow_grid_init ( FlowGrid *self )
   g_free(sig);
 }
 
+static gboolean flow_grid_update_cb ( GtkWidget *self )
+{
+  FlowGridPrivate *priv;
+
+  g_return_val_if_fail(IS_FLOW_GRID(self), FALSE);
+  priv = flow_grid_get_instance_private(FLOW_GRID(self));
+
+  priv->update_h = 0;
+  flow_grid_update(self);
+  return FALSE;
+}
+
+/* an autoupdating grid schedules a single update once it's invalidated,
+ * changes arriving within the delay are applied together */
+static void flow_grid_schedule ( GtkWidget *self )
+{
+  FlowGridPrivate *priv;
+
+  priv = flow_grid_get_instance_private(FLOW_GRID(self));
+
+  if(priv->autoupdate && !priv->update_h)
+    priv->update_h = g_timeout_add(100, (GSourceFunc)flow_grid_update_cb,
+        self);
+}
+
+void flow_grid_set_autoupdate ( GtkWidget *self, gboolean autoupdate )
+{
+  FlowGridPrivate *priv;
+
+  g_return_if_fail(IS_FLOW_GRID(self));
+  priv = flow_grid_get_instance_private(FLOW_GRID(self));
+
+  priv->autoupdate = autoupdate;
+  if(priv->invalid)
+    flow_grid_schedule(self);
+}
+
 void flow_grid_set_limit ( GtkWidget *self, gboolean limit )
 {
   FlowGridPrivate *priv;
@@ -246,6 +286,7 @@ void flow_grid_invalidate ( GtkWidget *self )
     flow_grid_invalidate(iter->data);
 
   priv->invalid = TRUE;
+  flow_grid_schedule(self);
 }
 
 void flow_grid_add_child ( GtkWidget *self, GtkWidget *child )
@@ -265,6 +306,7 @@ void flow_grid_add_child ( GtkWidget *self, GtkWidget *child )
   flow_item_decorate(child, ppriv->labels, ppriv->icons);
   flow_item_set_title_width(child, ppriv->title_width);
   priv->invalid = TRUE;
+  flow_grid_schedule(self);
 }
 
 void flow_grid_delete_child ( GtkWidget *self, void *source )
@@ -286,6 +328,7 @@ void flow_grid_delete_child ( GtkWidget *self, void *source )
       break;
     }
   priv->invalid = TRUE;
+  flow_grid_schedule(self);
 }
 
 void flow_grid_child_position ( GtkGrid *grid, GtkWidget *child, gint x, gint y )
@@ -39,6 +39,8 @@ struct _FlowGridPrivate
   gint title_width;
   gboolean limit;
   gboolean invalid;
+  gboolean autoupdate;
+  guint update_h;
   gboolean sort;
   GList *children;
   gint (*comp)( GtkWidget *, GtkWidget *, GtkWidget * );
@@ -55,6 +57,7 @@ gint flow_grid_get_rows ( GtkWidget *self );
 gint flow_grid_get_cols ( GtkWidget *self );
 void flow_grid_set_primary ( GtkWidget *self, gint primary );
 void flow_grid_set_limit ( GtkWidget *self, gboolean limit );
+void flow_grid_set_autoupdate ( GtkWidget *self, gboolean autoupdate );
 void flow_grid_add_child ( GtkWidget *self, GtkWidget *child );
 gboolean flow_grid_update ( GtkWidget *self );
 void flow_grid_invalidate ( GtkWidget *self );
@@ -28,7 +28,6 @@ static void pager_destroy ( GtkWidget *self )
   g_return_if_fail(IS_PAGER(self));
   workspace_listener_remove(self);
   priv = pager_get_instance_private(PAGER(self));
-  g_source_remove(priv->timer_h);
   g_list_free_full(g_steal_pointer(&priv->pins), g_free);
   GTK_WIDGET_CLASS(pager_parent_class)->destroy(self);
 }
@@ -59,11 +58,7 @@ static void pager_class_init ( PagerClass *kclass )
 
 static void pager_init ( Pager *self )
 {
-  PagerPrivate *priv;
-
-  priv = pager_get_instance_private(PAGER(self));
-  priv->timer_h = g_timeout_add(100, (GSourceFunc)flow_grid_update, self);
-
+  flow_grid_set_autoupdate(GTK_WIDGET(self), TRUE);
   if(!workspace_api_check())
     css_add_class(GTK_WIDGET(self), "hidden");
   flow_grid_invalidate(GTK_WIDGET(self));
@@ -27,7 +27,6 @@ struct _PagerClass
 struct _PagerPrivate
 {
   GList *pins;
-  guint timer_h;
 };
 
 GType pager_get_type ( void );
@@ -236,6 +236,16 @@ void popup_resize_maybe ( GtkWidget *self )
       g_object_get_data(G_OBJECT(self), "seat"));
 }
 
+static void popup_map_cb ( GtkWidget *win )
+{
+  base_widget_scanner_window_mapped(TRUE);
+}
+
+static void popup_unmap_cb ( GtkWidget *win )
+{
+  base_widget_scanner_window_mapped(FALSE);
+}
+
 void popup_size_allocate_cb ( GtkWidget *grid, gpointer dummy, GtkWidget *win )
 {
   popup_resize_maybe(win);
@@ -271,6 +281,8 @@ GtkWidget *popup_new ( gchar *name )
       win);
   g_signal_connect(win,"window-state-event", G_CALLBACK(popup_state_cb),NULL);
   g_signal_connect(grid, "size-allocate", G_CALLBACK(popup_size_allocate_cb), win);
+  g_signal_connect(win, "map", G_CALLBACK(popup_map_cb), NULL);
+  g_signal_connect(win, "unmap", G_CALLBACK(popup_unmap_cb), NULL);
 
   g_hash_table_insert(popup_list,g_strdup(name),win);
   return win;
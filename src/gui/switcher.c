@@ -31,11 +31,11 @@ static gboolean switcher_update ( GtkWidget *self )
 {
   GList *iter;
 
-  if(!switcher_grid)
-    return TRUE;
-
-  if(counter <= 0)
-    return TRUE;
+  if(!switcher_grid || counter <= 0)
+  {
+    timer_handle = 0;
+    return FALSE;
+  }
   counter--;
 
   if(counter > 0)
@@ -93,8 +93,6 @@ static void switcher_init ( Switcher *self )
   gtk_layer_set_layer(GTK_WINDOW(switcher_win), GTK_LAYER_SHELL_LAYER_OVERLAY);
   gtk_widget_set_name(switcher_win, "switcher");
   gtk_container_add(GTK_CONTAINER(switcher_win), GTK_WIDGET(self));
-  timer_handle = g_timeout_add(100, (GSourceFunc)switcher_update, self);
-
   hstate = 's';
 }
 
@@ -139,6 +137,10 @@ gboolean switcher_event ( gpointer dir )
   if(counter<1 || !focus)
     focus = wintree_from_id(wintree_get_focus());
   counter = interval + 1;
+  /* the timer only runs while the switcher is active */
+  if(!timer_handle)
+    timer_handle = g_timeout_add(100, (GSourceFunc)switcher_update,
+        switcher_grid);
 
   for (iter = wintree_get_list(); iter; iter = g_list_next(iter) )
     if(switcher_check(switcher_grid, iter->data))
@@ -30,14 +30,14 @@ static void taskbar_class_init ( TaskbarClass *kclass )
 static void taskbar_init ( Taskbar *self )
 {
   GBytes *action;
-  static guint8 data[sizeof(gpointer)+2];
+  static guint8 data[EXPR_FUNCTION_LEN];
   gpointer fptr = vm_func_lookup("taskbaritemdefault");
 
   flow_grid_invalidate(GTK_WIDGET(self));
   data[0] = EXPR_OP_FUNCTION;
   memcpy(data+2, &fptr, sizeof(gpointer));
 
-  action = g_bytes_new_static(data, sizeof(gpointer)+2);
+  action = g_bytes_new_static(data, EXPR_FUNCTION_LEN);
   base_widget_set_action(GTK_WIDGET(self), 1, 0, action);
 }
 
@@ -17,13 +17,8 @@ G_DEFINE_TYPE_WITH_CODE (TaskbarShell, taskbar_shell, TASKBAR_TYPE,
 
 static void taskbar_shell_destroy ( GtkWidget *self )
 {
-  TaskbarShellPrivate *priv;
-
-  priv = taskbar_shell_get_instance_private(TASKBAR_SHELL(self));
-
   wintree_listener_remove(self);
   workspace_listener_remove(self);
-  g_source_remove(priv->timer_h);
   GTK_WIDGET_CLASS(taskbar_shell_parent_class)->destroy(self);
 }
 
@@ -116,7 +111,7 @@ static void taskbar_shell_init ( TaskbarShell *self )
 
   priv = taskbar_shell_get_instance_private(TASKBAR_SHELL(self));
   priv->get_taskbar = taskbar_get_taskbar;
-  priv->timer_h = g_timeout_add(100, (GSourceFunc)flow_grid_update, self);
+  flow_grid_set_autoupdate(GTK_WIDGET(self), TRUE);
   priv->title_width = -1;
   wintree_listener_register(&taskbar_shell_window_listener, self);
   workspace_listener_register(&taskbar_shell_workspace_listener, self);
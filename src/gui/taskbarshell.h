@@ -29,7 +29,6 @@ struct _TaskbarShellPrivate
   GtkWidget *(*get_taskbar)(GtkWidget *, window_t *, gboolean);
   gboolean icons, labels, sort, floating_filter;
   gint rows, cols, filter, title_width;
-  guint timer_h;
   gchar *style;
   GList *css;
 };
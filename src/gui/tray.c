@@ -6,21 +6,10 @@
 #include "trayitem.h"
 #include "tray.h"
 
-G_DEFINE_TYPE_WITH_CODE (Tray, tray, FLOW_GRID_TYPE, G_ADD_PRIVATE (Tray))
-
-static void tray_destroy ( GtkWidget *self )
-{
-  TrayPrivate *priv;
-
-  g_return_if_fail(IS_TRAY(self));
-  priv = tray_get_instance_private(TRAY(self));
-  g_source_remove(priv->timer_h);
-  GTK_WIDGET_CLASS(tray_parent_class)->destroy(self);
-}
+G_DEFINE_TYPE (Tray, tray, FLOW_GRID_TYPE)
 
 static void tray_class_init ( TrayClass *kclass )
 {
-  GTK_WIDGET_CLASS(kclass)->destroy = tray_destroy;
   BASE_WIDGET_CLASS(kclass)->action_exec = NULL;
   sni_init();
 }
@@ -43,11 +32,8 @@ static sni_listener_t tray_sni_listener = {
 
 static void tray_init ( Tray *self )
 {
-  TrayPrivate *priv;
-
   sni_listener_register(&tray_sni_listener, self);
-  priv = tray_get_instance_private(TRAY(self));
-  priv->timer_h = g_timeout_add(100, (GSourceFunc)flow_grid_update, self);
+  flow_grid_set_autoupdate(GTK_WIDGET(self), TRUE);
   gtk_grid_set_column_homogeneous(
       GTK_GRID(base_widget_get_child(GTK_WIDGET(self))), FALSE);
 
@@ -23,13 +23,6 @@ struct _TrayClass
   FlowGridClass parent_class;
 };
 
-typedef struct _TrayPrivate TrayPrivate;
-
-struct _TrayPrivate
-{
-  guint timer_h;
-};
-
 GType tray_get_type ( void );
 
 GtkWidget *tray_new();
@@ -344,7 +344,7 @@ static void sway_ipc_scan_input ( struct json_object *obj, gint32 etype )
 
   scan = json_object_new_object();
   json_object_object_add_ex(scan, ename[etype-0x80000000], obj, 0);
-  g_list_foreach(sway_file->vars, (GFunc)scanner_var_reset, NULL);
+  g_ptr_array_foreach(sway_file->vars, (GFunc)scanner_var_reset, NULL);
   scanner_update_json(scan, sway_file);
   json_object_get(obj);
   json_object_put(scan);
@@ -567,8 +567,8 @@ void sway_ipc_init ( void )
 
   if((main_ipc = sway_ipc_open(10))<0)
     return;
-  vm_func_add("swaycmd", sway_ipc_cmd_action, TRUE);
-  vm_func_add("swaywincmd", sway_ipc_wincmd_action, TRUE);
+  vm_func_add("swaycmd", sway_ipc_cmd_action, FALSE);
+  vm_func_add("swaywincmd", sway_ipc_wincmd_action, FALSE);
   sway_ipc_send(main_ipc, 2, "['workspace','mode','window','barconfig_update',\
       'binding','shutdown','tick','bar_state_update','input']");
   g_io_add_watch(g_io_channel_unix_new(main_ipc), G_IO_IN, sway_ipc_event,
@@ -4,18 +4,68 @@
  */
 
 #include <glib.h>
+#include <glib-unix.h>
+#include <errno.h>
+#include <signal.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <glob.h>
+#include <fnmatch.h>
 #include "client.h"
 #include "config/config.h"
+#include "trigger.h"
 #include "util/json.h"
+#include "util/jsonstream.h"
+#include "util/linereader.h"
 #include "util/string.h"
 #include "vm/expr.h"
 
-static GList *file_list;
+/* a terminated command is killed if it's still running after the grace
+ * period, a command with no timeout is terminated after the default one */
+#define SCANNER_EXEC_GRACE 1000
+#define SCANNER_EXEC_TIMEOUT 60000
+/* default interval for which the expansion of a file pattern is cached */
+#define SCANNER_GLOB_INTERVAL 10000
+
+static GPtrArray *file_list;
+static GHashTable *file_names;
 static GHashTable *scan_list;
+static GHashTable *scan_slots;
+static GHashTable *scan_refs;
+static GMutex slot_mutex;
 static GHashTable *trigger_list;
+static GMainContext *exec_context;
+static GMutex exec_mutex;
+static GThreadPool *refresh_pool;
+static GMutex refresh_mutex;
+static GCond refresh_cond;
+static gint refresh_pending;
+static GSList *retired_values;
+static GMutex retired_mutex;
+static gint value_readers;
+static gint scanner_epoch;
+static GPrivate scanner_held;
+
+static void scanner_value_unref ( ScanValue *value );
+static void scanner_var_values_update ( ScanVar *var, gchar *value );
+
+typedef struct scan_exec {
+  ScanFile *file;
+  GPid pid;
+  gint fd;
+  GByteArray *buf;
+  GSource *read_src;
+  GSource *timeout_src;
+  gboolean eof;
+  gboolean exited;
+  gboolean expired;
+} scan_exec_t;
+
+typedef struct scan_fd {
+  gint fd;
+  dev_t dev;
+  ino_t ino;
+} scan_fd_t;
 
 void scanner_file_attach ( const gchar *trigger, ScanFile *file )
 {
@@ -33,49 +83,370 @@ ScanFile *scanner_file_get ( gchar *trigger )
   return g_hash_table_lookup(trigger_list, (void *)g_intern_string(trigger));
 }
 
-void scanner_file_merge ( ScanFile *keep, ScanFile *temp )
+static void scanner_prefix_free ( ScanPrefix *node )
+{
+  ScanPrefix *next;
+
+  while(node)
+  {
+    next = node->next;
+    scanner_prefix_free(node->child);
+    g_list_free(node->vars);
+    g_free(node);
+    node = next;
+  }
+}
+
+static void scanner_file_matcher_reset ( ScanFile *file )
+{
+  if(!file || !file->matcher)
+    return;
+
+  scanner_prefix_free(file->matcher->root);
+  g_list_free(file->matcher->fallback);
+  json_stream_free(file->matcher->stream);
+  g_clear_pointer(&file->matcher, g_free);
+}
+
+/* get a literal prefix of an anchored regex, i.e. "^cpu ([0-9]+)" -> "cpu " */
+static gchar *scanner_regex_prefix ( const gchar *pattern )
+{
+  const gchar *ptr;
+
+  if(!pattern || *pattern!='^' || strchr(pattern, '|'))
+    return NULL;
+
+  for(ptr=pattern+1; *ptr && !strchr("\\.^$|?*+()[]{}", *ptr); ptr++);
+
+  /* the last literal is optional if followed by ?, * or {n,m} */
+  if(*ptr && strchr("?*{", *ptr))
+    ptr--;
+
+  if(ptr<=pattern+1)
+    return NULL;
+
+  return g_strndup(pattern+1, ptr-pattern-1);
+}
+
+static void scanner_prefix_add ( ScanMatcher *matcher, gchar *prefix,
+    ScanVar *var )
+{
+  ScanPrefix **node, *parent = NULL;
+  gchar *ptr;
+
+  node = &matcher->root;
+  for(ptr=prefix; *ptr; ptr++)
+  {
+    while(*node && (*node)->c != *ptr)
+      node = &(*node)->next;
+    if(!*node)
+    {
+      *node = g_malloc0(sizeof(ScanPrefix));
+      (*node)->c = *ptr;
+    }
+    parent = *node;
+    node = &parent->child;
+  }
+  parent->vars = g_list_append(parent->vars, var);
+}
+
+static void scanner_json_stream_cb ( ScanVar *var, const gchar *value,
+    gpointer data )
+{
+  scanner_var_values_update(var, g_strdup(value));
+}
+
+/* route regex variables with an anchored literal prefix through a prefix
+ * tree, so each line is only matched against variables it can match. If
+ * all json paths of the file can be matched while streaming, the json is
+ * never parsed into a full tree */
+static ScanMatcher *scanner_file_matcher_build ( ScanFile *file )
+{
+  ScanMatcher *matcher;
+  ScanVar *var;
+  gchar *prefix;
+  gboolean stream = FALSE;
+  guint i;
+
+  for(i=0; i<file->vars->len; i++)
+    if(((ScanVar *)g_ptr_array_index(file->vars, i))->type == G_TOKEN_JSON)
+    {
+      stream = jpath_is_streamable(
+          ((ScanVar *)g_ptr_array_index(file->vars, i))->jpath);
+      if(!stream)
+        break;
+    }
+
+  matcher = g_malloc0(sizeof(ScanMatcher));
+  if(stream)
+    matcher->stream = json_stream_new((json_stream_func)scanner_json_stream_cb,
+        NULL);
+  for(i=0; i<file->vars->len; i++)
+  {
+    var = g_ptr_array_index(file->vars, i);
+    if(var->type == G_TOKEN_JSON && matcher->stream)
+      json_stream_add(matcher->stream, var->jpath, var);
+    else if(var->type == G_TOKEN_REGEX && var->definition && (prefix =
+          scanner_regex_prefix(g_regex_get_pattern(var->definition))) )
+    {
+      scanner_prefix_add(matcher, prefix, var);
+      g_free(prefix);
+    }
+    else
+      matcher->fallback = g_list_append(matcher->fallback, var);
+  }
+
+  return matcher;
+}
+
+static void scanner_file_unwatch ( ScanFile *file )
 {
   GList *iter;
 
-  file_list = g_list_remove(file_list, temp);
+  if(file->rewatch_h)
+    g_source_remove(file->rewatch_h);
+  file->rewatch_h = 0;
+  for(iter=file->monitors; iter; iter=g_list_next(iter))
+  {
+    g_signal_handlers_disconnect_by_data(iter->data, file);
+    g_file_monitor_cancel(iter->data);
+  }
+  g_list_free_full(g_steal_pointer(&file->monitors), g_object_unref);
+}
 
-  for(iter=temp->vars; iter; iter=g_list_next(iter))
-    ((ScanVar *)(iter->data))->file = keep;
-  keep->vars = g_list_concat(keep->vars, temp->vars);
+static void scanner_file_var_add ( ScanFile *file, ScanVar *var )
+{
+  var->file = file;
+  var->index = file->vars->len;
+  g_ptr_array_add(file->vars, var);
+}
+
+static void scanner_file_var_remove ( ScanFile *file, ScanVar *var )
+{
+  g_ptr_array_remove_index_fast(file->vars, var->index);
+  if(var->index < file->vars->len)
+    ((ScanVar *)g_ptr_array_index(file->vars, var->index))->index =
+      var->index;
+  var->file = NULL;
+}
 
+void scanner_file_merge ( ScanFile *keep, ScanFile *temp )
+{
+  guint i;
+
+  g_ptr_array_remove(file_list, temp);
+  if(g_hash_table_lookup(file_names, temp->fname) == temp)
+    g_hash_table_remove(file_names, temp->fname);
+  scanner_file_matcher_reset(keep);
+  scanner_file_matcher_reset(temp);
+  g_clear_pointer(&temp->fds, g_hash_table_destroy);
+  g_clear_pointer(&temp->buf, g_byte_array_unref);
+  g_clear_pointer(&temp->reader, line_reader_free);
+  scanner_file_unwatch(temp);
+  g_strfreev(temp->paths);
+
+  for(i=0; i<temp->vars->len; i++)
+    scanner_file_var_add(keep, g_ptr_array_index(temp->vars, i));
+  g_ptr_array_free(temp->vars, TRUE);
+
+  g_mutex_clear(&temp->mutex);
   g_free(temp->fname);
   g_free(temp);
 }
 
+static void scanner_file_watch ( ScanFile *file );
+
+/* match a path against the pattern of a source, or if prefix is set,
+ * against the leading components of the pattern (i.e. a directory that
+ * may hold matching files) */
+static gboolean scanner_file_path_match ( ScanFile *file, const gchar *path,
+    gboolean prefix )
+{
+  gchar *pattern;
+  const gchar *ptr;
+  gboolean match;
+  gint depth;
+
+  if(!path)
+    return FALSE;
+  if(file->flags & VF_NOGLOB)
+    return !g_strcmp0(path, file->fname);
+  if(!fnmatch(file->fname, path, FNM_PATHNAME))
+    return TRUE;
+  if(!prefix)
+    return FALSE;
+
+  for(depth=0, ptr=path; (ptr = strchr(ptr, '/')); ptr++)
+    depth++;
+  for(ptr=file->fname; depth && (ptr = strchr(ptr, '/')); ptr++)
+    depth--;
+  if(!ptr || !(ptr = strchr(ptr, '/')))
+    return FALSE;
+
+  pattern = g_strndup(file->fname, ptr - file->fname);
+  match = !fnmatch(pattern, path, FNM_PATHNAME);
+  g_free(pattern);
+
+  return match;
+}
+
+static gboolean scanner_file_rewatch ( ScanFile *file )
+{
+  file->rewatch_h = 0;
+  scanner_file_watch(file);
+
+  return FALSE;
+}
+
+static void scanner_file_watch_cb ( GFileMonitor *monitor, GFile *gfile,
+    GFile *other, GFileMonitorEvent event, ScanFile *file )
+{
+  ScanVar *var;
+  gchar *path;
+  guint i;
+  gboolean match, structural;
+
+  switch(event)
+  {
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+    case G_FILE_MONITOR_EVENT_RENAMED:
+      structural = TRUE;
+      break;
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+      structural = FALSE;
+      break;
+    default:
+      return;
+  }
+
+  path = g_file_get_path(gfile);
+  match = scanner_file_path_match(file, path, structural);
+  g_free(path);
+  if(!match && structural && other)
+  {
+    path = g_file_get_path(other);
+    match = scanner_file_path_match(file, path, TRUE);
+    g_free(path);
+  }
+
+  if(!match)
+    return;
+
+  g_atomic_int_set(&file->changed, TRUE);
+  for(i=0; i<file->vars->len; i++)
+    g_atomic_int_set(&((ScanVar *)g_ptr_array_index(file->vars, i))->invalid,
+        TRUE);
+
+  /* a new directory may have appeared under a wildcard, the monitors are
+   * rebuilt once the monitor emitting this event has returned */
+  if(structural)
+  {
+    g_atomic_int_set(&file->rescan, TRUE);
+    if(!(file->flags & VF_NOGLOB) && !file->rewatch_h)
+      file->rewatch_h = g_idle_add((GSourceFunc)scanner_file_rewatch, file);
+  }
+
+  if(file->trigger)
+    trigger_emit((gchar *)file->trigger);
+
+  /* wake the scanner for the expressions reading the file, they re-read it
+   * without waiting for their next poll */
+  for(i=0; i<file->vars->len; i++)
+    if( (var = g_ptr_array_index(file->vars, i))->slot )
+      expr_dep_trigger((gchar *)var->slot->name);
+}
+
+static void scanner_file_watch_dir ( gchar *dir, void *dummy, ScanFile *file )
+{
+  GFileMonitor *monitor;
+  GFile *gfile;
+
+  gfile = g_file_new_for_path(dir);
+  monitor = g_file_monitor_directory(gfile, G_FILE_MONITOR_WATCH_MOVES,
+      NULL, NULL);
+  g_object_unref(gfile);
+  if(!monitor)
+    return;
+
+  g_signal_connect(G_OBJECT(monitor), "changed",
+      G_CALLBACK(scanner_file_watch_cb), file);
+  file->monitors = g_list_prepend(file->monitors, monitor);
+}
+
+/* watch the directories holding the files matching the pattern, as well as
+ * the deepest directory that doesn't contain any wildcards */
+static void scanner_file_watch ( ScanFile *file )
+{
+  GHashTable *dirs;
+  glob_t gbuf;
+  gchar *base;
+  gint i;
+
+  scanner_file_unwatch(file);
+  dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+  base = g_strdup(file->fname);
+  if(!(file->flags & VF_NOGLOB))
+    base[strcspn(base, "*?[")] = '\0';
+  g_hash_table_add(dirs, g_path_get_dirname(base));
+  g_free(base);
+
+  if(!(file->flags & VF_NOGLOB))
+  {
+    if(!glob(file->fname, GLOB_NOSORT, NULL, &gbuf))
+      for(i=0; gbuf.gl_pathv[i]; i++)
+        g_hash_table_add(dirs, g_path_get_dirname(gbuf.gl_pathv[i]));
+    globfree(&gbuf);
+  }
+
+  g_hash_table_foreach(dirs, (GHFunc)scanner_file_watch_dir, file);
+  g_hash_table_destroy(dirs);
+
+  g_atomic_int_set(&file->rescan, TRUE);
+  g_atomic_int_set(&file->changed, TRUE);
+}
+
 ScanFile *scanner_file_new ( gint source, gchar *fname,
     gchar *trigger, gint flags )
 {
   ScanFile *file;
-  GList *iter;
-
-  if(source == SO_CLIENT)
-    iter = NULL;
-  else
-    for(iter=file_list;iter;iter=g_list_next(iter))
-      if(!g_strcmp0(fname,((ScanFile *)(iter->data))->fname))
-        break;
 
-  if(iter)
+  if(!file_list)
   {
-    file = iter->data;
-    g_free(fname);
+    file_list = g_ptr_array_new();
+    file_names = g_hash_table_new(g_str_hash, g_str_equal);
   }
+
+  if(source != SO_CLIENT && fname &&
+      (file = g_hash_table_lookup(file_names, fname)) )
+    g_free(fname);
   else
   {
     file = g_malloc0(sizeof(ScanFile));
-    file_list = g_list_append(file_list,file);
+    g_mutex_init(&file->mutex);
+    file->vars = g_ptr_array_new();
     file->fname = fname;
+    g_ptr_array_add(file_list, file);
+    if(source != SO_CLIENT && fname)
+      g_hash_table_insert(file_names, file->fname, file);
   }
 
+  /* the cached expansion depends on the flags, so it's dropped whenever
+   * they are (re)applied. The file count is updated on the next read */
+  g_mutex_lock(&file->mutex);
   file->source = source;
   file->flags = flags;
   if( !strchr(file->fname,'*') && !strchr(file->fname,'?') )
     file->flags |= VF_NOGLOB;
+  file->glob_interval = SCANNER_GLOB_INTERVAL * 1000;
+  file->glob_time = 0;
+  file->glob_count = (file->source != SO_FILE && (file->flags & VF_NOGLOB));
+  g_clear_pointer(&file->paths, g_strfreev);
+  g_clear_pointer(&file->fds, g_hash_table_destroy);
+  g_mutex_unlock(&file->mutex);
 
   if(file->trigger != g_intern_string(trigger))
   {
@@ -87,23 +458,58 @@ ScanFile *scanner_file_new ( gint source, gchar *fname,
   }
   g_free(trigger);
 
+  if(file->source == SO_FILE && (file->flags & VF_WATCH) && !file->monitors)
+    scanner_file_watch(file);
+  else if(!(file->flags & VF_WATCH) && file->monitors)
+    scanner_file_unwatch(file);
+
   return file;
 }
 
 void scanner_var_free ( ScanVar *var )
 {
+  if(var->slot)
+    g_atomic_pointer_set(&var->slot->var, NULL);
   if(var->file)
-    var->file->vars = g_list_remove(var->file->vars,var);
+  {
+    scanner_file_matcher_reset(var->file);
+    scanner_file_var_remove(var->file, var);
+  }
   if(var->type != G_TOKEN_REGEX)
     g_free(var->definition);
   else
     if(var->definition)
       g_regex_unref(var->definition);
   expr_cache_free(var->expr);
+  jpath_free(var->jpath);
+  if(var->value)
+    scanner_value_unref(var->value);
   g_free(var->str);
+  if(var->array)
+    g_array_unref(var->array);
+  if(var->parray)
+    g_array_unref(var->parray);
   g_free(var);
 }
 
+static ScanSlot *scanner_slot_get ( const gchar *name )
+{
+  ScanSlot *slot;
+
+  if(!scan_slots)
+    scan_slots = g_hash_table_new((GHashFunc)str_nhash,
+        (GEqualFunc)str_nequal);
+
+  if( !(slot = g_hash_table_lookup(scan_slots, name)) )
+  {
+    slot = g_malloc0(sizeof(ScanSlot));
+    slot->name = g_intern_string(name);
+    g_hash_table_insert(scan_slots, (gchar *)slot->name, slot);
+  }
+
+  return slot;
+}
+
 void scanner_var_new ( gchar *name, ScanFile *file, gchar *pattern,
     guint type, gint flag )
 {
@@ -119,10 +525,16 @@ void scanner_var_new ( gchar *name, ScanFile *file, gchar *pattern,
 
   var = old? old: g_malloc0(sizeof(ScanVar));
 
-  var->file = file;
+  if(var->file && var->file != file)
+  {
+    scanner_file_matcher_reset(var->file);
+    scanner_file_var_remove(var->file, var);
+  }
+  if(file && var->file != file)
+    scanner_file_var_add(file, var);
   var->type = type;
   var->multi = flag;
-  var->invalid = TRUE;
+  g_atomic_int_set(&var->invalid, TRUE);
 
   switch(var->type)
   {
@@ -130,6 +542,7 @@ void scanner_var_new ( gchar *name, ScanFile *file, gchar *pattern,
       expr_cache_free(var->expr);
       var->expr = expr_cache_new();
       var->expr->code = (GBytes *)pattern;
+      var->expr->name = g_intern_string(name);
       var->expr->eval = TRUE;
       var->vstate = 1;
       expr_dep_trigger(name);
@@ -137,6 +550,8 @@ void scanner_var_new ( gchar *name, ScanFile *file, gchar *pattern,
     case G_TOKEN_JSON:
       g_free(var->definition);
       var->definition = g_strdup(pattern);
+      jpath_free(var->jpath);
+      var->jpath = jpath_compile(pattern);
       break;
     case G_TOKEN_REGEX:
       if(var->definition)
@@ -145,8 +560,7 @@ void scanner_var_new ( gchar *name, ScanFile *file, gchar *pattern,
       break;
   }
 
-  if(file && !old)
-    file->vars = g_list_append(file->vars, var);
+  scanner_file_matcher_reset(file);
 
   if(!scan_list)
     scan_list = g_hash_table_new_full((GHashFunc)str_nhash,
@@ -155,69 +569,254 @@ void scanner_var_new ( gchar *name, ScanFile *file, gchar *pattern,
   if(!old)
   {
     g_hash_table_insert(scan_list, g_strdup(name), var);
+    g_mutex_lock(&slot_mutex);
+    var->slot = scanner_slot_get(name);
+    g_mutex_unlock(&slot_mutex);
+  }
+
+  /* regex and grab variables skip the string value unless an expression
+   * reads the variable as a string */
+  g_mutex_lock(&slot_mutex);
+  g_atomic_int_set(&var->numeric, (type == G_TOKEN_REGEX ||
+        type == G_TOKEN_GRAB) && !var->slot->string);
+  g_mutex_unlock(&slot_mutex);
+
+  if(!old)
+  {
+    g_atomic_pointer_set(&var->slot->var, var);
     expr_dep_trigger(name);
   }
 }
 
-void scanner_var_invalidate ( void *key, ScanVar *var, void *data )
+/* expire all variables in the tree, a variable is stale if it wasn't
+ * updated during the current epoch. Client sources are push driven and
+ * only expire when invalidated explicitly */
+void scanner_invalidate ( void )
+{
+  g_atomic_int_inc(&scanner_epoch);
+}
+
+static gboolean scanner_var_is_stale ( ScanVar *var )
 {
-  if( !var->file || var->file->source != SO_CLIENT )
-    var->invalid = TRUE;
+  return g_atomic_int_get(&var->invalid) ||
+    ((!var->file || var->file->source != SO_CLIENT) &&
+      var->epoch != g_atomic_int_get(&scanner_epoch));
 }
 
-/* expire all variables in the tree */
-void scanner_invalidate ( void )
+static void scanner_var_validate ( ScanVar *var )
+{
+  g_atomic_int_set(&var->invalid, FALSE);
+  var->epoch = g_atomic_int_get(&scanner_epoch);
+}
+
+static void scanner_value_clear ( ScanValue *value )
+{
+  if(value->str)
+    g_ref_string_release(value->str);
+  if(value->array)
+    g_array_unref(value->array);
+  if(value->parray)
+    g_array_unref(value->parray);
+}
+
+static void scanner_value_unref ( ScanValue *value )
+{
+  g_atomic_rc_box_release_full(value, (GDestroyNotify)scanner_value_clear);
+}
+
+/* get a reference to the current value snapshot of a variable. The reader
+ * count covers the window between loading the pointer and taking the
+ * reference, so a snapshot is never freed under a reader */
+static ScanValue *scanner_value_get ( ScanVar *var )
+{
+  ScanValue *value;
+
+  g_atomic_int_inc(&value_readers);
+  if( (value = g_atomic_pointer_get(&var->value)) )
+    g_atomic_rc_box_acquire(value);
+  (void)g_atomic_int_dec_and_test(&value_readers);
+
+  return value;
+}
+
+/* replaced snapshots are released once no reader is between loading a
+ * snapshot pointer and acquiring it */
+static void scanner_value_retire ( ScanValue *value )
+{
+  GSList *list = NULL;
+
+  g_mutex_lock(&retired_mutex);
+  retired_values = g_slist_prepend(retired_values, value);
+  if(!g_atomic_int_get(&value_readers))
+    list = g_steal_pointer(&retired_values);
+  g_mutex_unlock(&retired_mutex);
+
+  g_slist_free_full(list, (GDestroyNotify)scanner_value_unref);
+}
+
+static gboolean scanner_array_equal ( GArray *a1, GArray *a2 )
+{
+  guint i;
+
+  if(!a1 || !a2)
+    return a1 == a2;
+  if(a1 == a2)
+    return TRUE;
+  if(a1->len != a2->len)
+    return FALSE;
+  for(i=0; i<a1->len; i++)
+    if(!value_equal(g_array_index(a1, value_t, i),
+          g_array_index(a2, value_t, i)))
+      return FALSE;
+
+  return TRUE;
+}
+
+/* the update time alone doesn't count as a change, expressions reading
+ * .time or .age are volatile instead. Neither does the previous value, it
+ * only moves when the current value does */
+static gboolean scanner_value_changed ( ScanValue *old, ScanValue *value )
+{
+  return !old || old->val != value->val ||
+    old->count != value->count || g_strcmp0(old->str, value->str) ||
+    !scanner_array_equal(old->array, value->array);
+}
+
+static GArray *scanner_array_copy ( GArray *array )
+{
+  GArray *copy;
+  value_t v1;
+  guint i;
+
+  copy = g_array_sized_new(FALSE, FALSE, sizeof(value_t), array->len);
+  g_array_set_clear_func(copy, (GDestroyNotify)value_free);
+  for(i=0; i<array->len; i++)
+  {
+    v1 = value_dup(g_array_index(array, value_t, i));
+    g_array_append_val(copy, v1);
+  }
+
+  return copy;
+}
+
+/* publish the working values of a variable as a new immutable snapshot,
+ * the working array keeps growing until the next reset, so the snapshot
+ * gets a copy of it */
+static void scanner_var_publish ( ScanVar *var )
+{
+  ScanValue *value, *old;
+  gboolean changed;
+
+  value = g_atomic_rc_box_new0(ScanValue);
+  value->val = var->val;
+  value->pval = var->pval;
+  value->time = var->time;
+  value->ptime = var->ptime;
+  value->count = var->count;
+  value->array = var->array? scanner_array_copy(var->array) : NULL;
+  value->parray = var->parray? g_array_ref(var->parray) : NULL;
+
+  if(!var->str_dirty && (old = scanner_value_get(var)))
+  {
+    value->str = old->str? g_ref_string_acquire(old->str) : NULL;
+    scanner_value_unref(old);
+  }
+  else if(var->str)
+    value->str = g_ref_string_new(var->str);
+  var->str_dirty = FALSE;
+
+  old = g_atomic_pointer_exchange(&var->value, value);
+  changed = scanner_value_changed(old, value);
+  if(old)
+    scanner_value_retire(old);
+
+  /* push the change to the dependent expressions */
+  if(changed && var->slot)
+    expr_dep_trigger((gchar *)var->slot->name);
+}
+
+static void scanner_var_values_append ( ScanVar *var, value_t value )
+{
+  if(!var->array)
+  {
+    var->array = g_array_new(FALSE, FALSE, sizeof(value_t));
+    g_array_set_clear_func(var->array, (GDestroyNotify)value_free);
+  }
+  g_array_append_val(var->array, value);
+  var->count++;
+}
+
+/* fold a numeric value into the variable according to its aggregator */
+static void scanner_var_values_fold ( ScanVar *var, gdouble val )
 {
-  if(scan_list)
-    g_hash_table_foreach(scan_list,(GHFunc)scanner_var_invalidate,NULL);
+  switch(var->multi)
+  {
+    case VT_ARRAY:
+      scanner_var_values_append(var, value_new_numeric(val));
+      return;
+    case VT_SUM:
+      var->val += val;
+      break;
+    case VT_PROD:
+      var->val *= val;
+      break;
+    case VT_LAST:
+      var->val = val;
+      break;
+    case VT_FIRST:
+      if(!var->count)
+        var->val = val;
+      break;
+  }
+  var->count++;
 }
 
-void scanner_var_values_update ( ScanVar *var, gchar *value)
+static void scanner_var_values_update ( ScanVar *var, gchar *value )
 {
   if(!value)
     return;
 
-  if(var->multi!=VT_FIRST || !var->count || var->type==G_TOKEN_SET)
+  if(var->multi==VT_ARRAY && var->type!=G_TOKEN_SET)
+    scanner_var_values_append(var, value_new_string(value));
+  else if(var->multi!=VT_FIRST || !var->count || var->type==G_TOKEN_SET)
   {
     g_free(var->str);
     var->str = value;
-    switch(var->multi)
-    {
-      case VT_SUM:
-        var->val += g_ascii_strtod(var->str,NULL);
-        break;
-      case VT_PROD:
-        var->val *= g_ascii_strtod(var->str,NULL);
-        break;
-      case VT_LAST:
-        var->val = g_ascii_strtod(var->str,NULL);
-        break;
-      case VT_FIRST:
-        if(!var->count)
-          var->val = g_ascii_strtod(var->str,NULL);
-        break;
-    }
-    var->count++;
+    var->str_dirty = TRUE;
+    scanner_var_values_fold(var, g_ascii_strtod(var->str,NULL));
   }
   else
     g_free(value);
 
-  var->invalid = FALSE;
+  scanner_var_validate(var);
 }
 
-void scanner_update_json ( struct json_object *obj, ScanFile *file )
+/* update a numeric only variable directly from a slice of the source */
+static void scanner_var_values_update_numeric ( ScanVar *var,
+    const gchar *value, gsize len )
 {
-  GList *node;
+  if(var->multi!=VT_FIRST || !var->count)
+    scanner_var_values_fold(var, string_to_numeric(value, len));
+
+  scanner_var_validate(var);
+}
+
+static void scanner_update_json_values ( struct json_object *obj,
+    ScanFile *file )
+{
+  ScanVar *var;
   struct json_object *ptr;
+  guint j;
   gint i;
 
-  for(node=file->vars;node!=NULL;node=g_list_next(node))
+  for(j=0; j<file->vars->len; j++)
   {
-    ptr = jpath_parse(((ScanVar *)node->data)->definition,obj);
+    var = g_ptr_array_index(file->vars, j);
+    ptr = jpath_eval(var->jpath, obj);
     if(ptr && json_object_is_type(ptr, json_type_array))
       for(i=0;i<json_object_array_length(ptr);i++)
       {
-        scanner_var_values_update(((ScanVar *)node->data),
+        scanner_var_values_update(var,
           g_strdup(json_object_get_string(json_object_array_get_idx(ptr,i))));
       }
     if(ptr)
@@ -225,74 +824,173 @@ void scanner_update_json ( struct json_object *obj, ScanFile *file )
   }
 }
 
-/* update variables in a specific file (or pipe) */
-GIOStatus scanner_file_update ( GIOChannel *in, ScanFile *file, gsize *size )
+void scanner_update_json ( struct json_object *obj, ScanFile *file )
 {
   ScanVar *var;
-  GList *node;
-  GMatchInfo *match;
-  struct json_tokener *json = NULL;
-  struct json_object *obj;
-  gchar *read_buff;
-  GIOStatus status;
-  gsize lsize;
+  guint i;
 
-  if(size)
-    *size = 0;
+  scanner_update_json_values(obj, file);
+  for(i=0; i<file->vars->len; i++)
+  {
+    var = g_ptr_array_index(file->vars, i);
+    if(var->jpath)
+      scanner_var_publish(var);
+  }
+}
 
-  while((status = g_io_channel_read_line(in,&read_buff,&lsize,NULL,NULL))
-      ==G_IO_STATUS_NORMAL)
+static void scanner_var_regex_match ( ScanVar *var, gchar *line )
+{
+  GMatchInfo *match = NULL;
+  gint start, end;
+
+  if(var->definition && g_regex_match(var->definition, line, 0, &match))
   {
-    if(size)
-      *size += lsize;
-    for(node=file->vars;node!=NULL;node=g_list_next(node))
+    if(!var->numeric)
+      scanner_var_values_update(var, g_match_info_fetch(match, 1));
+    else if(g_match_info_fetch_pos(match, 1, &start, &end) && start>=0)
+      scanner_var_values_update_numeric(var, line + start, end - start);
+  }
+  if(match)
+    g_match_info_free(match);
+}
+
+static void scanner_file_line ( ScanFile *file, gchar *line, gsize lsize,
+    struct json_tokener **json, struct json_object **obj )
+{
+  ScanVar *var;
+  ScanPrefix *prefix;
+  GList *node;
+  gchar *ptr;
+
+  for(node=file->matcher->fallback;node!=NULL;node=g_list_next(node))
+  {
+    var=node->data;
+    switch(var->type)
     {
-      var=node->data;
-      switch(var->type)
-      {
-        case G_TOKEN_REGEX:
-          if(var->definition &&
-              g_regex_match (var->definition, read_buff, 0, &match))
-            scanner_var_values_update(var,g_match_info_fetch (match, 1));
-          if(match)
-            g_match_info_free (match);
-          break;
-        case G_TOKEN_GRAB:
-          if(lsize>0 && *(read_buff+lsize-1)=='\n')
-            *(read_buff+lsize-1)='\0';
-          scanner_var_values_update(var,g_strdup(read_buff));
-          break;
-        case G_TOKEN_JSON:
-          if(!json)
-            json = json_tokener_new();
-          break;
-      }
+      case G_TOKEN_REGEX:
+        scanner_var_regex_match(var, line);
+        break;
+      case G_TOKEN_GRAB:
+        if(lsize>0 && *(line+lsize-1)=='\n')
+          *(line+lsize-1)='\0';
+        if(var->numeric)
+          scanner_var_values_update_numeric(var, line, strlen(line));
+        else
+          scanner_var_values_update(var,g_strdup(line));
+        break;
+      case G_TOKEN_JSON:
+        if(!*json && !file->matcher->stream)
+          *json = json_tokener_new();
+        break;
     }
-    if(json)
-      obj = json_tokener_parse_ex(json,read_buff,
-          strlen(read_buff));
-    g_free(read_buff);
   }
-  g_free(read_buff);
 
+  prefix = file->matcher->root;
+  for(ptr=line; prefix && *ptr; ptr++)
+  {
+    while(prefix && prefix->c != *ptr)
+      prefix = prefix->next;
+    if(!prefix)
+      break;
+    for(node=prefix->vars; node; node=g_list_next(node))
+      scanner_var_regex_match(node->data, line);
+    prefix = prefix->child;
+  }
+
+  if(file->matcher->stream)
+    json_stream_feed(file->matcher->stream, line, strlen(line));
+  else if(*json)
+    *obj = json_tokener_parse_ex(*json, line, strlen(line));
+}
+
+static void scanner_file_finish ( ScanFile *file, struct json_tokener *json,
+    struct json_object *obj )
+{
+  ScanVar *var;
+  guint i;
+
+  if(file->matcher && file->matcher->stream)
+    json_stream_finish(file->matcher->stream);
   if(json)
   {
-    scanner_update_json(obj,file);
+    scanner_update_json_values(obj, file);
     json_object_put(obj);
     json_tokener_free(json);
   }
 
-  for(node=file->vars;node!=NULL;node=g_list_next(node))
+  /* a glob over several paths publishes once all of them are read */
+  for(i=0; i<file->vars->len; i++)
+  {
+    var = g_ptr_array_index(file->vars, i);
+    if(!file->deferred)
+      scanner_var_publish(var);
+    scanner_var_validate(var);
+  }
+}
+
+/* update variables in a specific file (or pipe) */
+GIOStatus scanner_file_update ( gint fd, ScanFile *file, gsize *size )
+{
+  struct json_tokener *json = NULL;
+  struct json_object *obj = NULL;
+  gchar *line;
+  GIOStatus status;
+  gsize lsize;
+
+  if(size)
+    *size = 0;
+
+  if(!file->matcher)
+    file->matcher = scanner_file_matcher_build(file);
+  if(!file->reader)
+    file->reader = line_reader_new(4096);
+
+  while((status = line_reader_next(file->reader, fd, &line, &lsize))
+      ==G_IO_STATUS_NORMAL)
   {
-    ((ScanVar *)node->data)->invalid = FALSE;
-    ((ScanVar *)node->data)->vstate = TRUE;
+    if(size)
+      *size += lsize;
+    scanner_file_line(file, line, lsize, &json, &obj);
   }
 
+  /* keep a partial line pending on a non-blocking source */
+  if(status != G_IO_STATUS_AGAIN)
+    line_reader_reset(file->reader);
+
+  scanner_file_finish(file, json, obj);
+
   g_debug("channel status %d, (%s)",status,file->fname?file->fname:"(null)");
 
   return status;
 }
 
+/* update variables from a buffer, the buffer must have room for a
+ * terminating null past len. Lines are split in place */
+void scanner_file_update_buffer ( ScanFile *file, gchar *buf, gsize len )
+{
+  struct json_tokener *json = NULL;
+  struct json_object *obj = NULL;
+  gchar *line, *end, saved;
+
+  if(!file->matcher)
+    file->matcher = scanner_file_matcher_build(file);
+
+  buf[len] = '\0';
+  for(line=buf; line<buf+len; line=end)
+  {
+    if( (end = memchr(line, '\n', buf+len-line)) )
+      end++;
+    else
+      end = buf+len;
+    saved = *end;
+    *end = '\0';
+    scanner_file_line(file, line, end-line, &json, &obj);
+    *end = saved;
+  }
+
+  scanner_file_finish(file, json, obj);
+}
+
 void scanner_var_reset ( ScanVar *var, gpointer dummy )
 {
   gint64 tv = g_get_monotonic_time();
@@ -300,106 +998,435 @@ void scanner_var_reset ( ScanVar *var, gpointer dummy )
   var->pval = var->val;
   var->count = 0;
   var->val = 0;
+  if(var->multi == VT_ARRAY)
+  {
+    if(var->parray)
+      g_array_unref(var->parray);
+    var->parray = var->array;
+    var->array = NULL;
+  }
   var->time = tv-var->ptime;
   var->ptime = tv;
 }
 
-time_t scanner_file_mtime ( glob_t *gbuf )
+/* get the latest modification time of a list of paths. The persistent
+ * descriptors of paths that disappeared or now refer to a different file
+ * are dropped, so the stat needed for CheckTime doubles as the check for
+ * replaced files */
+time_t scanner_file_mtime ( ScanFile *file, gchar **paths )
 {
   gint i;
   struct stat stattr;
+  scan_fd_t *sfd;
   time_t res = 0;
 
-  for(i=0;gbuf->gl_pathv[i]!=NULL;i++)
-    if(!stat(gbuf->gl_pathv[i],&stattr))
-      res = MAX(stattr.st_mtime, res);
+  for(i=0;paths[i]!=NULL;i++)
+  {
+    sfd = file->fds? g_hash_table_lookup(file->fds, paths[i]) : NULL;
+    if(stat(paths[i],&stattr))
+    {
+      if(sfd)
+        g_hash_table_remove(file->fds, paths[i]);
+      continue;
+    }
+    if(sfd && (sfd->dev != stattr.st_dev || sfd->ino != stattr.st_ino))
+      g_hash_table_remove(file->fds, paths[i]);
+    res = MAX(stattr.st_mtime, res);
+  }
 
   return res;
 }
 
+static gpointer scanner_exec_thread ( GMainContext *context )
+{
+  GMainLoop *loop;
+
+  g_main_context_push_thread_default(context);
+  loop = g_main_loop_new(context, FALSE);
+  g_main_loop_run(loop);
+
+  return NULL;
+}
+
+static void scanner_exec_finish ( scan_exec_t *job )
+{
+  ScanFile *file = job->file;
+
+  if(!job->eof || !job->exited)
+    return;
+
+  g_mutex_lock(&exec_mutex);
+
+  if(job->timeout_src)
+  {
+    g_source_destroy(job->timeout_src);
+    g_source_unref(job->timeout_src);
+  }
+
+  if(job->expired)
+    g_message("scanner: '%s' timed out", file->fname);
+  else
+  {
+    g_mutex_lock(&file->mutex);
+    g_ptr_array_foreach(file->vars,(GFunc)scanner_var_reset,NULL);
+    /* reserve room for the terminator scanner_file_update_buffer adds */
+    g_byte_array_append(job->buf, (guint8 *)"", 1);
+    scanner_file_update_buffer(file, (gchar *)job->buf->data,
+        job->buf->len - 1);
+    if(file->trigger)
+      trigger_emit((gchar *)file->trigger);
+    g_mutex_unlock(&file->mutex);
+  }
+
+  g_byte_array_unref(job->buf);
+  g_free(job);
+  file->exec = NULL;
+  g_mutex_unlock(&exec_mutex);
+}
+
+static gboolean scanner_exec_read ( gint fd, GIOCondition cond,
+    scan_exec_t *job )
+{
+  gchar chunk[4096];
+  gssize len;
+
+  while( (len = read(fd, chunk, sizeof(chunk))) > 0 )
+    g_byte_array_append(job->buf, (guint8 *)chunk, len);
+
+  if(len < 0 && (errno == EAGAIN || errno == EINTR))
+    return G_SOURCE_CONTINUE;
+
+  close(fd);
+  g_source_unref(job->read_src);
+  job->read_src = NULL;
+  job->eof = TRUE;
+  scanner_exec_finish(job);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void scanner_exec_exit ( GPid pid, gint status, scan_exec_t *job )
+{
+  g_spawn_close_pid(pid);
+  job->exited = TRUE;
+  scanner_exec_finish(job);
+}
+
+static void scanner_exec_attach ( GSource *src, GSourceFunc cb,
+    scan_exec_t *job )
+{
+  g_source_set_callback(src, cb, job, NULL);
+  g_source_attach(src, exec_context);
+}
+
+static gboolean scanner_exec_expire ( scan_exec_t *job )
+{
+  gboolean kill_now;
+
+  kill_now = job->expired || (job->file->flags & VF_KILL);
+  job->expired = TRUE;
+  kill(-job->pid, kill_now? SIGKILL : SIGTERM);
+  g_source_unref(job->timeout_src);
+  job->timeout_src = NULL;
+
+  if(!kill_now)
+  {
+    job->timeout_src = g_timeout_source_new(SCANNER_EXEC_GRACE);
+    scanner_exec_attach(job->timeout_src, (GSourceFunc)scanner_exec_expire,
+        job);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+/* run the command in its own process group, so that a timeout also
+ * reaches any processes it spawns (e.g. the members of a pipeline) */
+static void scanner_exec_setup ( gpointer data )
+{
+  setpgid(0, 0);
+}
+
+/* run the command in the background, the output is collected on the exec
+ * thread and parsed once the command exits. If the previous run of the same
+ * source is still in progress, the request is folded into it */
 gboolean scanner_file_exec ( ScanFile *file )
 {
-  GIOChannel *chan;
-  gint out;
+  scan_exec_t *job;
+  GSource *src;
   gchar **argv;
+  GPid pid;
+  gint out;
+
+  g_mutex_lock(&exec_mutex);
+  if(file->exec)
+  {
+    g_mutex_unlock(&exec_mutex);
+    return TRUE;
+  }
+
+  if(!exec_context)
+  {
+    exec_context = g_main_context_new();
+    g_thread_unref(g_thread_new("scanner-exec",
+          (GThreadFunc)scanner_exec_thread, exec_context));
+  }
 
   if(!g_shell_parse_argv(file->fname, NULL, &argv, NULL))
+  {
+    g_mutex_unlock(&exec_mutex);
     return FALSE;
+  }
 
-  if(!g_spawn_async_with_pipes(NULL,argv,NULL,G_SPAWN_SEARCH_PATH,NULL,NULL,
-        NULL, NULL, &out, NULL, NULL))
+  if(!g_spawn_async_with_pipes(NULL, argv, NULL,
+        G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD, scanner_exec_setup,
+        NULL,
+        &pid, NULL, &out, NULL, NULL))
+  {
+    g_strfreev(argv);
+    g_mutex_unlock(&exec_mutex);
     return FALSE;
+  }
+  g_strfreev(argv);
+  g_unix_set_fd_nonblocking(out, TRUE, NULL);
+
+  g_debug("scanner: exec '%s'",file->fname);
+  job = g_malloc0(sizeof(scan_exec_t));
+  job->file = file;
+  job->pid = pid;
+  job->fd = out;
+  job->buf = g_byte_array_new();
+  file->exec = job;
+
+  job->read_src = g_unix_fd_source_new(out, G_IO_IN | G_IO_HUP | G_IO_ERR);
+  scanner_exec_attach(job->read_src, (GSourceFunc)scanner_exec_read, job);
+  src = g_child_watch_source_new(pid);
+  scanner_exec_attach(src, (GSourceFunc)scanner_exec_exit, job);
+  g_source_unref(src);
+  job->timeout_src = g_timeout_source_new(file->timeout > 0?
+      file->timeout : SCANNER_EXEC_TIMEOUT);
+  scanner_exec_attach(job->timeout_src, (GSourceFunc)scanner_exec_expire, job);
+  g_mutex_unlock(&exec_mutex);
+
+  return TRUE;
+}
+
+static void scanner_fd_close ( scan_fd_t *sfd )
+{
+  close(sfd->fd);
+  g_free(sfd);
+}
 
-  chan = g_io_channel_unix_new(out);
-  if(chan)
+/* get a persistent descriptor for a path. The descriptor is kept until a
+ * read from it fails, or (with CheckTime) until scanner_file_mtime finds
+ * the path replaced */
+static gint scanner_file_fd ( ScanFile *file, gchar *path )
+{
+  struct stat stattr;
+  scan_fd_t *sfd;
+  gint fd;
+
+  if(!file->fds)
+    file->fds = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+        (GDestroyNotify)scanner_fd_close);
+
+  if( (sfd = g_hash_table_lookup(file->fds, path)) )
+    return sfd->fd;
+
+  if( (fd = open(path, O_RDONLY | O_CLOEXEC)) == -1 )
+    return -1;
+  if(fstat(fd, &stattr))
   {
-    g_debug("scanner: exec '%s'",file->fname);
-    g_list_foreach(file->vars,(GFunc)scanner_var_reset,NULL);
-    (void)scanner_file_update(chan,file,NULL);
-    g_io_channel_unref(chan);
+    close(fd);
+    return -1;
   }
-  close(out);
 
-  return TRUE;
+  sfd = g_malloc(sizeof(scan_fd_t));
+  sfd->fd = fd;
+  sfd->dev = stattr.st_dev;
+  sfd->ino = stattr.st_ino;
+  g_hash_table_insert(file->fds, g_strdup(path), sfd);
+
+  return fd;
 }
 
-/* update all variables in a file (by glob) */
-gboolean scanner_file_glob ( ScanFile *file )
+/* close the descriptors of paths no longer matching the pattern */
+static gboolean scanner_fd_expired ( gchar *path, scan_fd_t *sfd,
+    gchar **paths )
+{
+  return !g_strv_contains((const gchar * const *)paths, path);
+}
+
+static gssize scanner_file_pread_fd ( gint fd, GByteArray *buf )
+{
+  gssize rlen;
+  gsize len = 0;
+
+  do
+  {
+    if(buf->len < len + 4097)
+      g_byte_array_set_size(buf, MAX(len + 4097, buf->len * 2));
+    rlen = pread(fd, buf->data + len, buf->len - len - 1, len);
+    if(rlen > 0)
+      len += rlen;
+  } while(rlen > 0);
+
+  return rlen<0? -1 : (gssize)len;
+}
+
+/* reread a file from a persistent descriptor */
+static gssize scanner_file_pread ( ScanFile *file, gchar *path )
+{
+  gssize len;
+  gint fd;
+
+  if(!file->buf)
+    file->buf = g_byte_array_new();
+
+  if( (fd = scanner_file_fd(file, path)) == -1 )
+    return -1;
+  if( (len = scanner_file_pread_fd(fd, file->buf)) >= 0 )
+    return len;
+
+  /* the descriptor went stale, retry once on a freshly opened file */
+  g_hash_table_remove(file->fds, path);
+  if( (fd = scanner_file_fd(file, path)) == -1 )
+    return -1;
+  if( (len = scanner_file_pread_fd(fd, file->buf)) < 0 )
+    g_hash_table_remove(file->fds, path);
+
+  return len;
+}
+
+/* expand the file pattern, the expansion is reused until the glob interval
+ * expires or a watched directory changes */
+static gchar **scanner_file_paths ( ScanFile *file, gboolean watched )
 {
   glob_t gbuf;
+  gint64 now;
+  gboolean rescan;
+
+  rescan = g_atomic_int_compare_and_exchange(&file->rescan, TRUE, FALSE);
+  now = g_get_monotonic_time();
+  if(file->paths && !rescan && (watched || (file->glob_interval &&
+        now < file->glob_time + file->glob_interval)))
+    return file->paths;
+
+  g_strfreev(file->paths);
+  if(!glob(file->fname, GLOB_NOSORT, NULL, &gbuf))
+    file->paths = g_strdupv(gbuf.gl_pathv);
+  else
+    file->paths = g_malloc0(sizeof(gchar *));
+  globfree(&gbuf);
+
+  if(file->fds)
+    g_hash_table_foreach_remove(file->fds, (GHRFunc)scanner_fd_expired,
+        file->paths);
+
+  file->glob_time = now;
+  file->glob_count = g_strv_length(file->paths);
+  return file->paths;
+}
+
+static gboolean scanner_file_read ( ScanFile *file )
+{
   gchar *dnames[2];
+  gchar **paths;
   struct stat stattr;
+  gssize len;
+  time_t mtime = 0;
   gint i;
-  gint in;
-  GIOChannel *chan;
-  gboolean reset=FALSE;
+  gint in, found = -1;
+  gboolean reset=FALSE, watched;
+
+  /* watched sources are only re-read after a change notification */
+  watched = !!g_atomic_pointer_get(&file->monitors);
+  if(watched && !g_atomic_int_compare_and_exchange(&file->changed, TRUE, FALSE))
+  {
+    g_ptr_array_foreach(file->vars, (GFunc)scanner_var_validate, NULL);
+    return TRUE;
+  }
 
-  if(!file)
-    return FALSE;
-  if(file->source == SO_CLIENT || !file->fname)
-    return FALSE;
-  if(file->source == SO_EXEC)
-    return scanner_file_exec(file);
   if((file->flags & VF_NOGLOB)||(file->source != SO_FILE))
   {
     dnames[0] = file->fname;
     dnames[1] = NULL;
-    gbuf.gl_pathv = dnames;
+    paths = dnames;
   }
-  else if(glob(file->fname,GLOB_NOSORT,NULL,&gbuf))
-  {
-    globfree(&gbuf);
+  else if( !*(paths = scanner_file_paths(file, watched)) )
     return FALSE;
-  }
 
-  if( !(file->flags & VF_CHTIME) || (file->mtime < scanner_file_mtime(&gbuf)) )
-    for(i=0;gbuf.gl_pathv[i];i++)
+  file->deferred = TRUE;
+  if( watched || !(file->flags & VF_CHTIME) ||
+      (file->mtime < (mtime = scanner_file_mtime(file, paths))) )
+    for(i=0, found=0;paths[i];i++)
     {
-      in = open(gbuf.gl_pathv[i],O_RDONLY);
+      if(file->flags & VF_PERSIST)
+      {
+        if( (len = scanner_file_pread(file, paths[i])) < 0 )
+          continue;
+        found++;
+        if(!reset)
+        {
+          reset=TRUE;
+          g_ptr_array_foreach(file->vars,(GFunc)scanner_var_reset,NULL);
+        }
+        scanner_file_update_buffer(file, (gchar *)file->buf->data, len);
+        if(mtime)
+          file->mtime = mtime;
+        continue;
+      }
+      in = open(paths[i],O_RDONLY);
       if(in != -1)
       {
+        found++;
         if(!reset)
         {
           reset=TRUE;
-          g_list_foreach(file->vars,(GFunc)scanner_var_reset,NULL);
+          g_ptr_array_foreach(file->vars,(GFunc)scanner_var_reset,NULL);
         }
 
-        chan = g_io_channel_unix_new(in);
-        (void)scanner_file_update(chan,file,NULL);
-        g_io_channel_unref(chan);
-
+        (void)scanner_file_update(in,file,NULL);
         close(in);
-        if(!stat(gbuf.gl_pathv[i],&stattr))
+        if(!watched && !stat(paths[i],&stattr))
           file->mtime = stattr.st_mtime;
       }
     }
+  file->deferred = FALSE;
 
-  if(!(file->flags & VF_NOGLOB)&&(file->source == SO_FILE))
-    globfree(&gbuf);
+  /* a NoGlob path counts as a single file while it exists, an unchanged
+   * CheckTime source keeps its count unless the path disappeared */
+  if(found < 0 && !mtime)
+    found = 0;
+  if(paths == dnames && found >= 0)
+    file->glob_count = found;
+
+  if(reset)
+    g_ptr_array_foreach(file->vars, (GFunc)scanner_var_publish, NULL);
 
   return TRUE;
 }
 
+/* update all variables in a file (by glob). A source already being read
+ * by another thread is left to it, readers get the values it publishes */
+gboolean scanner_file_glob ( ScanFile *file )
+{
+  gboolean result;
+
+  if(!file)
+    return FALSE;
+  if(file->source == SO_CLIENT || !file->fname)
+    return FALSE;
+  if(file->source == SO_EXEC)
+    return scanner_file_exec(file);
+
+  if(!g_mutex_trylock(&file->mutex))
+    return TRUE;
+  result = scanner_file_read(file);
+  g_mutex_unlock(&file->mutex);
+
+  return result;
+}
+
 gchar *scanner_parse_identifier ( gchar *id, gchar **fname )
 {
   gchar *ptr;
@@ -423,105 +1450,319 @@ gchar *scanner_parse_identifier ( gchar *id, gchar **fname )
     return g_strdup(id);
 }
 
-ScanVar *scanner_var_update ( gchar *name, gboolean update, expr_cache_t *expr )
+/* record a source referenced by an expression and any expressions
+ * evaluating it */
+static void scanner_expr_source_add ( expr_cache_t *expr, ScanFile *file )
 {
-  ScanVar *var;
+  g_mutex_lock(&refresh_mutex);
+  for(; expr; expr=expr->parent)
+    if(!g_list_find(expr->sources, file))
+      expr->sources = g_list_prepend(expr->sources, file);
+  g_mutex_unlock(&refresh_mutex);
+}
 
-  if(!scan_list)
-    return NULL;
+/* record the sources of a Set variable on an expression reading it. Only
+ * one reader evaluates the variable (and only after a change is pushed to
+ * it), so the other readers wouldn't record them otherwise */
+static void scanner_expr_source_inherit ( expr_cache_t *expr,
+    expr_cache_t *src )
+{
+  GList *iter;
+
+  if(!expr || !g_atomic_pointer_get(&src->sources))
+    return;
+
+  g_mutex_lock(&refresh_mutex);
+  for(; expr; expr=expr->parent)
+    for(iter=src->sources; iter; iter=g_list_next(iter))
+      if(!g_list_find(expr->sources, iter->data))
+        expr->sources = g_list_prepend(expr->sources, iter->data);
+  g_mutex_unlock(&refresh_mutex);
+}
+
+/* add sources referenced by an expression to a list of sources */
+GList *scanner_expr_sources ( expr_cache_t *expr, GList *files )
+{
+  GList *iter;
+
+  if(!expr)
+    return files;
+
+  g_mutex_lock(&refresh_mutex);
+  for(iter=expr->sources; iter; iter=g_list_next(iter))
+    if(!g_list_find(files, iter->data))
+      files = g_list_prepend(files, iter->data);
+  g_mutex_unlock(&refresh_mutex);
+
+  return files;
+}
+
+static void scanner_file_refresh_cb ( ScanFile *file, gpointer data )
+{
+  expr_dep_mute(TRUE);
+  (void)scanner_file_glob(file);
+
+  g_mutex_lock(&refresh_mutex);
+  if(!--refresh_pending)
+    g_cond_signal(&refresh_cond);
+  g_mutex_unlock(&refresh_mutex);
+}
+
+/* while held, the calling thread reads the published values of stale
+ * variables instead of refreshing (or spawning) their sources. Watched
+ * sources are still read once a change to them is reported */
+void scanner_hold ( gboolean hold )
+{
+  g_private_set(&scanner_held, GINT_TO_POINTER(hold));
+}
+
+/* update a list of sources in parallel and wait for all of them */
+void scanner_file_refresh ( GList *files )
+{
+  GList *iter;
+
+  if(!files)
+    return;
+  if(!files->next)
+  {
+    (void)scanner_file_glob(files->data);
+    return;
+  }
+
+  if(!refresh_pool)
+    refresh_pool = g_thread_pool_new((GFunc)scanner_file_refresh_cb, NULL,
+        g_get_num_processors(), FALSE, NULL);
+
+  g_mutex_lock(&refresh_mutex);
+  refresh_pending = g_list_length(files);
+  for(iter=files; iter; iter=g_list_next(iter))
+    g_thread_pool_push(refresh_pool, iter->data, NULL);
+  while(refresh_pending)
+    g_cond_wait(&refresh_cond, &refresh_mutex);
+  g_mutex_unlock(&refresh_mutex);
+}
 
-  var = g_hash_table_lookup(scan_list, name);
+static ScanVar *scanner_var_update ( ScanVar *var, gboolean update,
+    expr_cache_t *expr )
+{
   if(!var)
     return NULL;
 
-  if(!update || (!var->invalid && var->type != G_TOKEN_SET))
+  /* client sources push their updates and are never polled */
+  if(var->file && var->type != G_TOKEN_SET && var->file->source != SO_CLIENT)
+    scanner_expr_source_add(expr, var->file);
+  else if(var->type == G_TOKEN_SET && var->expr)
+    scanner_expr_source_inherit(expr, var->expr);
+
+  if(!update || (!scanner_var_is_stale(var) && var->type != G_TOKEN_SET))
   {
     if(expr)
       expr->vstate = expr->vstate || var->vstate;
     return var;
   }
 
+  /* only one thread evaluates a Set variable at a time (this also stops a
+   * variable from evaluating itself), the others read the last published
+   * snapshot */
   if(var->type == G_TOKEN_SET)
   {
-    if(!var->inuse)
+    if(g_atomic_int_compare_and_exchange(&var->inuse, FALSE, TRUE))
     {
-      var->inuse = TRUE;
       var->expr->parent = expr;
       (void)expr_cache_eval(var->expr);
       var->expr->parent = NULL;
-      var->inuse = FALSE;
       var->vstate = var->expr->vstate;
-      if(expr)
-        expr->vstate = expr->vstate || var->expr->vstate;
-      if(var->invalid)
+      if(scanner_var_is_stale(var))
         scanner_var_reset(var, NULL);
       scanner_var_values_update(var,g_strdup(var->expr->cache));
-      var->invalid = FALSE;
+      scanner_var_publish(var);
+      scanner_var_validate(var);
+      g_atomic_int_set(&var->inuse, FALSE);
     }
-  }
-  else
-  {
-    scanner_file_glob(var->file);
     if(expr)
-      expr->vstate = TRUE;
-    var->vstate = TRUE;
+      expr->vstate = expr->vstate || var->vstate;
   }
+  else if(!g_private_get(&scanner_held) || (var->file &&
+      g_atomic_pointer_get(&var->file->monitors) &&
+       g_atomic_int_get(&var->file->changed)))
+    scanner_file_glob(var->file);
 
   return var;
 }
 
-/* get value of a variable by name */
-value_t scanner_get_value ( gchar *ident, gboolean update, expr_cache_t *expr )
+/* copy an array variable, converting the elements to the requested type */
+static value_t scanner_array_get ( GArray *array, gboolean string )
+{
+  GArray *result;
+  value_t value;
+  guint i;
+
+  result = g_array_sized_new(FALSE, FALSE, sizeof(value_t),
+      array? array->len : 0);
+  g_array_set_clear_func(result, (GDestroyNotify)value_free);
+
+  for(i=0; array && i<array->len; i++)
+  {
+    value = g_array_index(array, value_t, i);
+    if(string && value_is_numeric(value))
+      value = value_new_string(numeric_to_string(value.value.numeric, -1));
+    else if(!string && value_is_string(value))
+      value = value_new_numeric(value_as_numeric(value));
+    else
+      value = value_dup(value);
+    g_array_append_val(result, value);
+  }
+
+  return value_new_array(result);
+}
+
+/* get a field of a variable through a resolved slot */
+value_t scanner_slot_value ( ScanSlot *slot, guint8 field, gboolean string,
+    gboolean update, expr_cache_t *expr )
 {
+  static const ScanValue empty;
+  const ScanValue *snap;
+  ScanValue *value;
   value_t result;
   ScanVar *var;
-  gchar *fname, *id;
 
-  id = scanner_parse_identifier(ident, &fname);
-  var = scanner_var_update(id, update, expr);
-  g_free(id);
+  var = scanner_var_update(g_atomic_pointer_get(&slot->var), update, expr);
 
   if(!var)
-  {
-    g_free(fname);
-    expr_dep_add(ident, expr);
     return value_na;
-  }
-  if(var->type == G_TOKEN_SET)
-    expr_dep_add(ident, expr);
 
-  if(*ident == '$')
+  value = scanner_value_get(var);
+  snap = value? value : &empty;
+
+  if(var->multi == VT_ARRAY && var->type != G_TOKEN_SET &&
+      (string || field == SV_VAL || field == SV_PVAL))
+    result = scanner_array_get(field == SV_PVAL? snap->parray : snap->array,
+        string);
+  else if(string)
   {
-    result.type = EXPR_TYPE_STRING;
-    result.value.string  = g_strdup(var->str);
+    result = snap->str? value_new_string_ref(g_ref_string_acquire(snap->str)) :
+      value_new_string(NULL);
   }
   else
   {
     result.type = EXPR_TYPE_NUMERIC;
-    if(!g_strcmp0(fname, ".val"))
-      result.value.numeric = var->val;
-    else if(!g_strcmp0(fname, ".pval"))
-      result.value.numeric = var->pval;
-    else if(!g_strcmp0(fname, ".count"))
-      result.value.numeric = var->count;
-    else if(!g_strcmp0(fname, ".time"))
-      result.value.numeric = var->time;
-    else if(!g_strcmp0(fname, ".age"))
-      result.value.numeric = (g_get_monotonic_time() - var->ptime);
-    else
-      result = value_na;
+    switch(field)
+    {
+      case SV_VAL:
+        result.value.numeric = snap->val;
+        break;
+      case SV_PVAL:
+        result.value.numeric = snap->pval;
+        break;
+      case SV_COUNT:
+        result.value.numeric = snap->count;
+        break;
+      case SV_TIME:
+        result.value.numeric = snap->time;
+        if(expr)
+          expr->vstate = TRUE;
+        break;
+      case SV_AGE:
+        result.value.numeric = (g_get_monotonic_time() - snap->ptime);
+        if(expr)
+          expr->vstate = TRUE;
+        break;
+      case SV_FILES:
+        result.value.numeric = var->file? var->file->glob_count : 0;
+        break;
+      default:
+        result = value_na;
+    }
   }
+  if(value)
+    scanner_value_unref(value);
 
-  g_free(fname);
   if(result.type == EXPR_TYPE_NUMERIC)
-    g_debug("scanner: %s = %f (vstate: %d)", ident, result.value.numeric,
+    g_debug("scanner: %s = %f (vstate: %d)", slot->name, result.value.numeric,
         (expr?  expr->vstate: 0));
   else if(result.type == EXPR_TYPE_STRING)
-    g_debug("scanner: %s = %s (vstate: %d)", ident, result.value.string,
+    g_debug("scanner: %s = %s (vstate: %d)", slot->name, result.value.string,
         (expr?  expr->vstate: 0));
   return result;
 }
 
+/* get value of a variable by name */
+value_t scanner_get_value ( gchar *ident, gboolean update, expr_cache_t *expr )
+{
+  ScanRef *ref;
+
+  if( !(ref = scanner_ref_get(ident)) )
+    return value_na;
+  return scanner_slot_value(ref->slot, ref->field, ref->string, update, expr);
+}
+
+static guint8 scanner_field_lookup ( const gchar *field )
+{
+  static const gchar *fields[] = {
+    [SV_VAL] = ".val",
+    [SV_PVAL] = ".pval",
+    [SV_COUNT] = ".count",
+    [SV_TIME] = ".time",
+    [SV_AGE] = ".age",
+    [SV_FILES] = ".files"
+  };
+  guint8 i;
+
+  for(i=0; i<SV_NONE; i++)
+    if(!g_ascii_strcasecmp(field, fields[i]))
+      return i;
+  return SV_NONE;
+}
+
+/* resolve an identifier (i.e. $Var or Var.pval) into a reference to the
+ * slot of the variable and a field, references live for the lifetime of
+ * the program, so the bytecode can carry them directly */
+ScanRef *scanner_ref_get ( const gchar *ident )
+{
+  ScanVar *var;
+  ScanRef *ref;
+  gchar *name, *field;
+
+  if(!ident)
+    return NULL;
+
+  ident = g_intern_string(ident);
+  g_mutex_lock(&slot_mutex);
+  if(!scan_refs)
+    scan_refs = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+  if( !(ref = g_hash_table_lookup(scan_refs, ident)) )
+  {
+    ref = g_malloc0(sizeof(ScanRef));
+    ref->ident = ident;
+    ref->string = (*ident == '$');
+    name = scanner_parse_identifier((gchar *)ident, &field);
+    ref->slot = scanner_slot_get(name);
+    ref->field = scanner_field_lookup(field);
+    /* the string mode of a variable is fixed when its references are
+     * resolved (i.e. at parse time). A variable already being scanned is
+     * only flagged, the scanner thread picks up the string on its next
+     * read */
+    if(ref->string && !ref->slot->string)
+    {
+      ref->slot->string = TRUE;
+      if( (var = g_atomic_pointer_get(&ref->slot->var)) &&
+          g_atomic_int_get(&var->numeric) )
+      {
+        g_atomic_int_set(&var->numeric, FALSE);
+        if(var->file)
+          g_atomic_int_set(&var->file->changed, TRUE);
+      }
+    }
+    g_free(name);
+    g_free(field);
+    g_hash_table_insert(scan_refs, (gchar *)ident, ref);
+  }
+  g_mutex_unlock(&slot_mutex);
+
+  return ref;
+}
+
 gboolean scanner_is_variable ( gchar *identifier )
 {
   gchar *name;
@@ -2,6 +2,8 @@
 #define __SCANNER_H__
 
 #include <json.h>
+#include "util/jsonstream.h"
+#include "util/linereader.h"
 #include "vm/expr.h"
 #include "vm/vm.h"
 
@@ -13,54 +15,138 @@ enum {
 
 enum {
   VF_CHTIME = 1,
-  VF_NOGLOB = 2
+  VF_NOGLOB = 2,
+  VF_PERSIST = 4,
+  VF_WATCH = 8,
+  VF_KILL = 16
+};
+
+enum {
+  SV_VAL,
+  SV_PVAL,
+  SV_COUNT,
+  SV_TIME,
+  SV_AGE,
+  SV_FILES,
+  SV_NONE
 };
 
 enum {
   VT_SUM = 1,
   VT_PROD,
   VT_LAST,
-  VT_FIRST
+  VT_FIRST,
+  VT_ARRAY
 };
 
+typedef struct scan_prefix {
+  gchar c;
+  GList *vars;
+  struct scan_prefix *child;
+  struct scan_prefix *next;
+} ScanPrefix;
+
+typedef struct scan_matcher {
+  ScanPrefix *root;
+  GList *fallback;
+  json_stream_t *stream;
+} ScanMatcher;
+
 typedef struct scan_file {
   gchar *fname;
   const gchar *trigger;
   gint flags;
   guchar source;
   time_t mtime;
-  GList *vars;
+  GPtrArray *vars;
+  ScanMatcher *matcher;
+  GHashTable *fds;
+  GByteArray *buf;
+  line_reader_t *reader;
+  GMutex mutex;
+  GList *monitors;
+  guint rewatch_h;
+  gchar **paths;
+  gint64 glob_interval;
+  gint64 glob_time;
+  gint glob_count;
+  gint changed;
+  gint rescan;
+  gboolean deferred;
+  gint64 timeout;
+  struct scan_exec *exec;
   void *client;
 } ScanFile;
 
+typedef struct scan_value {
+  double val;
+  double pval;
+  gint64 time;
+  gint64 ptime;
+  gint count;
+  gchar *str;
+  GArray *array;
+  GArray *parray;
+} ScanValue;
+
 typedef struct scan_var {
   expr_cache_t *expr;
   void *definition;
+  jpath_t *jpath;
   gchar *str;
   guint vstate;
   double val;
   double pval;
+  GArray *array;
+  GArray *parray;
   gint64 time;
   gint64 ptime;
   gint count;
   gint multi;
   guint type;
   gboolean invalid;
+  gint epoch;
+  guint index;
+  struct scan_slot *slot;
   gboolean inuse;
+  gboolean numeric;
+  gboolean str_dirty;
+  ScanValue *value;
   ScanFile *file;
 } ScanVar;
 
+typedef struct scan_slot {
+  const gchar *name;
+  ScanVar *var;
+  gboolean string;
+} ScanSlot;
+
+typedef struct scan_ref {
+  const gchar *ident;
+  ScanSlot *slot;
+  guint8 field;
+  gboolean string;
+} ScanRef;
+
 void scanner_invalidate ( void );
 void scanner_var_reset ( ScanVar *var, gpointer dummy );
 void scanner_update_json ( struct json_object *, ScanFile * );
-GIOStatus scanner_file_update ( GIOChannel *, ScanFile *, gsize * );
+GIOStatus scanner_file_update ( gint fd, ScanFile *, gsize * );
+void scanner_file_update_buffer ( ScanFile *file, gchar *buf, gsize len );
 int scanner_glob_file ( ScanFile * );
+void scanner_file_refresh ( GList *files );
+void scanner_hold ( gboolean hold );
+GList *scanner_expr_sources ( expr_cache_t *expr, GList *files );
 value_t scanner_get_value ( gchar *ident, gboolean update, expr_cache_t *expr );
+ScanRef *scanner_ref_get ( const gchar *ident );
+value_t scanner_slot_value ( ScanSlot *slot, guint8 field, gboolean string,
+    gboolean update, expr_cache_t *expr );
 void scanner_var_new ( gchar *, ScanFile *, gchar *, guint, gint );
 void scanner_file_merge ( ScanFile *keep, ScanFile *temp );
 gchar *scanner_parse_identifier ( gchar *id, gchar **fname );
 ScanFile *scanner_file_get ( gchar *trigger );
 ScanFile *scanner_file_new ( gint , gchar *, gchar *, gint );
+gboolean scanner_file_glob ( ScanFile *file );
 gboolean scanner_is_variable ( gchar *identifier );
 void scanner_file_attach ( const gchar *trigger, ScanFile *file );
 
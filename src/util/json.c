@@ -132,154 +132,124 @@ GdkRectangle json_rect_get ( struct json_object *json )
   return ret;
 }
 
-gboolean jpath_filter_test ( GScanner *scanner, gint idx, gchar *key,
-    gboolean eq, struct json_object *obj, GTokenType type, GTokenValue val )
+struct json_object *jpath_parse ( gchar *path, struct json_object *obj )
+{
+  jpath_t *jpath;
+  struct json_object *result;
+
+  if(!path || !obj || !(jpath = jpath_compile(path)))
+    return NULL;
+
+  result = jpath_eval(jpath, obj);
+  jpath_free(jpath);
+
+  return result;
+}
+
+static gboolean jpath_filter_test ( jpath_step_t *step, gint idx,
+    struct json_object *obj )
 {
   struct json_object *tmp;
 
-  switch(type)
+  switch(step->op)
   {
-    case ']':
+    case JPATH_ANY:
       return TRUE;
-      break;
-    case G_TOKEN_INT:
-      if(idx==val.v_int)
-        return TRUE;
-      break;
-    case G_TOKEN_STRING:
-      json_object_object_get_ex(obj,key,&tmp);
-      if(tmp && !eq)
-        return TRUE;
-      if(tmp && eq && scanner->token == G_TOKEN_STRING)
-        if(!g_ascii_strcasecmp(val.v_string,json_object_get_string(tmp)))
-          return TRUE;
-      if(tmp && eq && scanner->token == G_TOKEN_INT)
-        if(val.v_int == json_object_get_int64(tmp))
-          return TRUE;
-      if(tmp && eq && scanner->token == G_TOKEN_FLOAT)
-        if(val.v_float == json_object_get_double(tmp))
-          return TRUE;
-      break;
+    case JPATH_INDEX:
+      return idx == step->index;
+    case JPATH_HAS:
+      return json_object_object_get_ex(obj, step->key, &tmp) && tmp;
+    case JPATH_EQ:
+      if(!json_object_object_get_ex(obj, step->key, &tmp) || !tmp)
+        return FALSE;
+      if(step->vtype == G_TOKEN_STRING)
+        return !g_ascii_strcasecmp(step->vstring, json_object_get_string(tmp));
+      if(step->vtype == G_TOKEN_INT)
+        return step->vnumeric == json_object_get_int64(tmp);
+      if(step->vtype == G_TOKEN_FLOAT)
+        return step->vnumeric == json_object_get_double(tmp);
+      return FALSE;
     default:
-      break;
+      return FALSE;
   }
-  return FALSE;
 }
 
-struct json_object *jpath_filter (GScanner *scanner, struct json_object *obj )
+static void jpath_add ( struct json_object *array, struct json_object *obj )
 {
-  struct json_object *next, *iter, *jiter;
-  gint i,j;
-  gchar *key=NULL;
-  GTokenType type;
-  GTokenValue val;
-  gboolean eq = FALSE;
-
-  next = json_object_new_array();
-  type = g_scanner_get_next_token(scanner);
-  switch(type)
+  if(obj)
+    json_object_array_add(array, json_object_get(obj));
+}
+
+static void jpath_step ( jpath_step_t *step, struct json_object *obj,
+    struct json_object *next )
+{
+  struct json_object *tmp;
+  gint j;
+
+  switch(step->op)
   {
-    case G_TOKEN_STRING:
-      key = g_strdup(scanner->value.v_string);
-      if(g_scanner_peek_next_token(scanner)=='=')
+    case JPATH_KEY:
+      if(!json_object_is_type(obj, json_type_array))
       {
-        eq = TRUE;
-        g_scanner_get_next_token(scanner);
-        scanner->config->scan_float = 1;
-        g_scanner_get_next_token(scanner);
-        val = scanner->value;
-        scanner->config->scan_float = 0;
+        if(json_object_object_get_ex(obj, step->key, &tmp))
+          jpath_add(next, tmp);
       }
       else
-        eq = FALSE;
-      break;
-    case ']':
-      break;
-    case G_TOKEN_INT:
-      val = scanner->value;
+        for(j=0; j<json_object_array_length(obj); j++)
+          if(json_object_object_get_ex(json_object_array_get_idx(obj, j),
+                step->key, &tmp))
+            jpath_add(next, tmp);
       break;
     default:
-      return next;
-      break;
-  }
-
-  for(i=0;i<json_object_array_length(obj);i++)
-  {
-    iter = json_object_array_get_idx(obj,i);
-    if(json_object_is_type(iter,json_type_array))
-      for(j=0;j<json_object_array_length(iter);j++)
+      if(!json_object_is_type(obj, json_type_array))
       {
-        jiter = json_object_array_get_idx(iter,j);
-        if(jpath_filter_test(scanner,j,key,eq,jiter,type,val))
-          json_object_array_add(next,jiter);
+        if(step->op != JPATH_INDEX && jpath_filter_test(step, -1, obj))
+          jpath_add(next, obj);
       }
-    else
-      if(jpath_filter_test(scanner,-1,key,eq,iter,type,val))
-        json_object_array_add(next,iter);
+      else
+        for(j=0; j<json_object_array_length(obj); j++)
+          if(jpath_filter_test(step, j, json_object_array_get_idx(obj, j)))
+            jpath_add(next, json_object_array_get_idx(obj, j));
+      break;
   }
-
-  if(type == G_TOKEN_STRING || type == G_TOKEN_INT)
-    if(g_scanner_get_next_token(scanner)!=']')
-      g_scanner_error(scanner,"missing ']'");
-  g_free(key);
-
-  return next;
 }
 
-struct json_object *jpath_key ( GScanner *scanner, struct json_object *obj )
+/* evaluate a compiled json path, the result is an array of all matching
+ * values, a top level array is treated as a list of values */
+struct json_object *jpath_eval ( jpath_t *jpath, struct json_object *obj )
 {
-  struct json_object *next, *iter, *tmp;
-  gint i,j;
+  struct json_object *cur, *next;
+  guint i;
+  gint j;
 
-  next = json_object_new_array();
+  if(!jpath || !obj)
+    return NULL;
 
-  for(i=0;i<json_object_array_length(obj);i++)
+  json_object_get(obj);
+  if(json_object_is_type(obj,json_type_array))
+    cur = obj;
+  else
   {
-    iter = json_object_array_get_idx(obj,i);
-    if(json_object_is_type(iter,json_type_array))
-      for(j=0;j<json_object_array_length(iter);j++)
-      {
-        json_object_object_get_ex(json_object_array_get_idx(iter,j),
-          scanner->value.v_string,&tmp);
-        if(tmp)
-          json_object_array_add(next,tmp);
-      }
-    else
-    {
-      json_object_object_get_ex(json_object_array_get_idx(obj,i),
-        scanner->value.v_string,&tmp);
-      if(tmp)
-        json_object_array_add(next,tmp);
-    }
+    cur = json_object_new_array();
+    json_object_array_add(cur,obj);
   }
-  return next;
-}
 
-struct json_object *jpath_index ( GScanner *scanner, struct json_object *obj )
-{
-  struct json_object *next, *iter;
-  gint i;
-
-  next = json_object_new_array();
-
-  for(i=0;i<json_object_array_length(obj);i++)
+  for(i=0; i<jpath->len; i++)
   {
-    iter = json_object_array_get_idx(obj,i);
-    if(json_object_is_type(iter,json_type_array))
-      json_object_array_add(next,
-           json_object_array_get_idx(iter,(gint)scanner->value.v_int));
+    next = json_object_new_array();
+    for(j=0; j<json_object_array_length(cur); j++)
+      jpath_step(&jpath->steps[i], json_object_array_get_idx(cur, j), next);
+    json_object_put(cur);
+    cur = next;
   }
-  return next;
+
+  return cur;
 }
 
-struct json_object *jpath_parse ( gchar *path, struct json_object *obj )
+static GScanner *jpath_scanner_new ( const gchar *path )
 {
   GScanner *scanner;
-  struct json_object *cur,*next;
-  gint i, sep;
 
-  if(!path || !obj)
-    return NULL;
   scanner = g_scanner_new(NULL);
   scanner->config->scan_octal = 0;
   scanner->config->symbol_2_token = 1;
@@ -291,49 +261,129 @@ struct json_object *jpath_parse ( gchar *path, struct json_object *obj )
   scanner->input_name = path;
   g_scanner_input_text(scanner, path, strlen(path));
 
-  if(g_scanner_get_next_token(scanner)!=G_TOKEN_CHAR)
-    return NULL;
+  return scanner;
+}
 
-  sep = scanner->value.v_char;
-  scanner->config->char_2_token = 1;
+static gboolean jpath_compile_filter ( GScanner *scanner, jpath_step_t *step )
+{
+  switch((gint)g_scanner_get_next_token(scanner))
+  {
+    case ']':
+      step->op = JPATH_ANY;
+      return TRUE;
+    case G_TOKEN_INT:
+      step->op = JPATH_INDEX;
+      step->index = scanner->value.v_int;
+      break;
+    case G_TOKEN_STRING:
+      step->op = JPATH_HAS;
+      step->key = g_strdup(scanner->value.v_string);
+      if(g_scanner_peek_next_token(scanner)!='=')
+        break;
+      g_scanner_get_next_token(scanner);
+      scanner->config->scan_float = 1;
+      step->op = JPATH_EQ;
+      step->vtype = g_scanner_get_next_token(scanner);
+      if(step->vtype == G_TOKEN_STRING)
+        step->vstring = g_strdup(scanner->value.v_string);
+      else if(step->vtype == G_TOKEN_INT)
+        step->vnumeric = scanner->value.v_int;
+      else if(step->vtype == G_TOKEN_FLOAT)
+        step->vnumeric = scanner->value.v_float;
+      scanner->config->scan_float = 0;
+      break;
+    default:
+      return FALSE;
+  }
 
-  json_object_get(obj);
-  if(json_object_is_type(obj,json_type_array))
-    cur = obj;
-  else
+  return g_scanner_get_next_token(scanner)==']';
+}
+
+/* compile a json path into a list of steps, the path is tokenized the same
+ * way as by jpath_parse */
+jpath_t *jpath_compile ( const gchar *path )
+{
+  GScanner *scanner;
+  GArray *steps;
+  jpath_step_t step;
+  jpath_t *jpath;
+  gboolean valid = TRUE;
+  gint sep;
+
+  if(!path)
+    return NULL;
+
+  scanner = jpath_scanner_new(path);
+  if(g_scanner_get_next_token(scanner)!=G_TOKEN_CHAR)
   {
-    cur = json_object_new_array();
-    json_object_array_add(cur,obj);
+    g_scanner_destroy(scanner);
+    return NULL;
   }
+  sep = scanner->value.v_char;
+  scanner->config->char_2_token = 1;
 
-  do 
+  steps = g_array_new(FALSE, TRUE, sizeof(jpath_step_t));
+  do
   {
+    memset(&step, 0, sizeof(step));
     switch((gint)g_scanner_get_next_token(scanner))
     {
       case '[':
-        next = jpath_filter(scanner,cur);
+        valid = jpath_compile_filter(scanner, &step);
         break;
       case G_TOKEN_STRING:
-        next = jpath_key(scanner,cur);
+        step.op = JPATH_KEY;
+        step.key = g_strdup(scanner->value.v_string);
         break;
       case G_TOKEN_INT:
-        next = jpath_index(scanner,cur);
+        step.op = JPATH_INDEX;
+        step.index = scanner->value.v_int;
         break;
       default:
-        g_scanner_error(scanner,"invalid token in json path %d %d",scanner->token,G_TOKEN_ERROR);
-        next = NULL;
+        valid = FALSE;
         break;
     }
-    if(next)
-    {
-      for(i=0;i<json_object_array_length(next);i++)
-        json_object_get(json_object_array_get_idx(next,i));
-      json_object_put(cur);
-      cur = next;
-    }
-  } while ( g_scanner_get_next_token(scanner) == sep );
+    g_array_append_val(steps, step);
+  } while (valid && g_scanner_get_next_token(scanner) == sep);
+  g_scanner_destroy(scanner);
 
-  g_scanner_destroy( scanner );
+  jpath = g_malloc0(sizeof(jpath_t));
+  jpath->len = steps->len;
+  jpath->steps = (jpath_step_t *)g_array_free(steps, FALSE);
 
-  return cur;
+  if(!valid)
+    g_clear_pointer(&jpath, jpath_free);
+
+  return jpath;
+}
+
+void jpath_free ( jpath_t *jpath )
+{
+  guint i;
+
+  if(!jpath)
+    return;
+
+  for(i=0; i<jpath->len; i++)
+  {
+    g_free(jpath->steps[i].key);
+    g_free(jpath->steps[i].vstring);
+  }
+  g_free(jpath->steps);
+  g_free(jpath);
+}
+
+/* filters depend on sibling values and can't be matched while streaming */
+gboolean jpath_is_streamable ( jpath_t *jpath )
+{
+  guint i;
+
+  if(!jpath)
+    return FALSE;
+
+  for(i=0; i<jpath->len; i++)
+    if(jpath->steps[i].op == JPATH_HAS || jpath->steps[i].op == JPATH_EQ)
+      return FALSE;
+
+  return TRUE;
 }
@@ -17,6 +17,32 @@ struct json_object *json_array_by_name ( struct json_object *obj, gchar *key );
 struct json_object *json_node_by_name ( struct json_object *json, gchar *key );
 GdkRectangle json_rect_get ( struct json_object *json );
 
+typedef enum {
+  JPATH_KEY,
+  JPATH_INDEX,
+  JPATH_ANY,
+  JPATH_HAS,
+  JPATH_EQ
+} jpath_op_t;
+
+typedef struct {
+  jpath_op_t op;
+  gchar *key;
+  gint64 index;
+  GTokenType vtype;
+  gchar *vstring;
+  gdouble vnumeric;
+} jpath_step_t;
+
+typedef struct {
+  jpath_step_t *steps;
+  guint len;
+} jpath_t;
+
 struct json_object *jpath_parse ( gchar *path, struct json_object *obj );
+jpath_t *jpath_compile ( const gchar *path );
+struct json_object *jpath_eval ( jpath_t *jpath, struct json_object *obj );
+void jpath_free ( jpath_t *jpath );
+gboolean jpath_is_streamable ( jpath_t *jpath );
 
 #endif
@@ -0,0 +1,356 @@
+/* This entire file is licensed under GNU General Public License v3.0
+ *
+ * Copyright 2025- sfwbar maintainers
+ */
+
+#include <glib.h>
+#include "util/jsonstream.h"
+
+/* A streaming matcher for a set of json paths. The input is tokenized one
+ * character at a time and only the values matching one of the paths are
+ * kept (as text), so memory use is bounded by the size of the matches and
+ * the nesting depth rather than the size of the document. The matching
+ * follows jpath_parse: a key step also looks into the elements of an array
+ * and a top level array is treated as a list of values */
+
+enum {
+  JS_VALUE,
+  JS_KEY,
+  JS_KEY_STRING,
+  JS_COLON,
+  JS_STRING,
+  JS_LITERAL,
+  JS_NEXT,
+  JS_ERROR
+};
+
+json_stream_t *json_stream_new ( json_stream_func func, gpointer data )
+{
+  json_stream_t *stream;
+
+  stream = g_malloc0(sizeof(json_stream_t));
+  stream->paths = g_ptr_array_new();
+  stream->targets = g_ptr_array_new();
+  stream->frames = g_array_new(FALSE, FALSE, sizeof(json_stream_frame_t));
+  stream->key = g_string_new(NULL);
+  stream->func = func;
+  stream->data = data;
+
+  return stream;
+}
+
+static void json_stream_capture_free ( json_stream_capture_t *capture )
+{
+  g_string_free(capture->text, TRUE);
+  g_free(capture);
+}
+
+static void json_stream_pop ( json_stream_t *stream )
+{
+  json_stream_frame_t *frame;
+
+  frame = &g_array_index(stream->frames, json_stream_frame_t,
+      stream->frames->len-1);
+  g_free(frame->key);
+  g_array_unref(frame->states);
+  g_array_set_size(stream->frames, stream->frames->len-1);
+}
+
+static void json_stream_reset ( json_stream_t *stream )
+{
+  while(stream->frames->len)
+    json_stream_pop(stream);
+  g_list_free_full(g_steal_pointer(&stream->captures),
+      (GDestroyNotify)json_stream_capture_free);
+  g_string_truncate(stream->key, 0);
+  stream->state = JS_VALUE;
+  stream->escape = FALSE;
+}
+
+void json_stream_free ( json_stream_t *stream )
+{
+  if(!stream)
+    return;
+
+  json_stream_reset(stream);
+  g_array_unref(stream->frames);
+  g_ptr_array_free(stream->paths, TRUE);
+  g_ptr_array_free(stream->targets, TRUE);
+  g_string_free(stream->key, TRUE);
+  g_free(stream);
+}
+
+/* the path is owned by the caller and must outlive the stream */
+void json_stream_add ( json_stream_t *stream, jpath_t *path, gpointer target )
+{
+  g_ptr_array_add(stream->paths, path);
+  g_ptr_array_add(stream->targets, target);
+}
+
+static void json_stream_state_add ( GArray *states, guint16 path,
+    guint16 step, gboolean flat )
+{
+  json_stream_state_t state = { .path = path, .step = step, .flat = flat };
+  guint i;
+
+  for(i=0; i<states->len; i++)
+    if(!memcmp(&g_array_index(states, json_stream_state_t, i), &state,
+          sizeof(state)))
+      return;
+  g_array_append_val(states, state);
+}
+
+/* compute path states of a value from the states of its container */
+static GArray *json_stream_states ( json_stream_t *stream, gboolean array )
+{
+  json_stream_frame_t *frame;
+  json_stream_state_t *state;
+  jpath_step_t *step;
+  jpath_t *path;
+  GArray *states;
+  guint i;
+
+  states = g_array_new(FALSE, FALSE, sizeof(json_stream_state_t));
+
+  if(!stream->frames->len)
+  {
+    for(i=0; i<stream->paths->len; i++)
+      json_stream_state_add(states, i, 0, FALSE);
+  }
+  else
+  {
+    frame = &g_array_index(stream->frames, json_stream_frame_t,
+        stream->frames->len-1);
+    for(i=0; i<frame->states->len; i++)
+    {
+      state = &g_array_index(frame->states, json_stream_state_t, i);
+      path = g_ptr_array_index(stream->paths, state->path);
+      if(frame->transparent)
+        json_stream_state_add(states, state->path, state->step, FALSE);
+      if(frame->transparent || state->step >= path->len)
+        continue;
+      step = &path->steps[state->step];
+      if(step->op == JPATH_KEY && frame->type == '{' &&
+          !g_strcmp0(frame->key, step->key))
+        json_stream_state_add(states, state->path, state->step+1, FALSE);
+      else if(step->op == JPATH_KEY && frame->type == '[' && !state->flat)
+        json_stream_state_add(states, state->path, state->step, TRUE);
+      else if(step->op == JPATH_INDEX && frame->type == '[' &&
+          step->index == frame->index)
+        json_stream_state_add(states, state->path, state->step+1, FALSE);
+      else if(step->op == JPATH_ANY && frame->type == '[')
+        json_stream_state_add(states, state->path, state->step+1, FALSE);
+    }
+  }
+
+  /* a wildcard step selects a value itself unless it's an array */
+  if(!array)
+    for(i=0; i<states->len; i++)
+    {
+      state = &g_array_index(states, json_stream_state_t, i);
+      path = g_ptr_array_index(stream->paths, state->path);
+      if(state->step < path->len && path->steps[state->step].op == JPATH_ANY)
+        json_stream_state_add(states, state->path, state->step+1, FALSE);
+    }
+
+  return states;
+}
+
+static void json_stream_value_start ( json_stream_t *stream, gchar c )
+{
+  json_stream_capture_t *capture;
+  json_stream_frame_t frame, *parent;
+  json_stream_state_t *state;
+  GArray *states;
+  GList *iter;
+  guint i;
+
+  if(stream->frames->len)
+  {
+    parent = &g_array_index(stream->frames, json_stream_frame_t,
+        stream->frames->len-1);
+    if(parent->type == '[')
+      parent->index++;
+  }
+
+  states = json_stream_states(stream, c == '[');
+  for(i=0; i<states->len; i++)
+  {
+    state = &g_array_index(states, json_stream_state_t, i);
+    if(state->step <
+        ((jpath_t *)g_ptr_array_index(stream->paths, state->path))->len)
+      continue;
+    capture = g_malloc0(sizeof(json_stream_capture_t));
+    capture->target = g_ptr_array_index(stream->targets, state->path);
+    capture->depth = stream->frames->len;
+    capture->text = g_string_new(NULL);
+    stream->captures = g_list_append(stream->captures, capture);
+  }
+  for(iter=stream->captures; iter; iter=g_list_next(iter))
+    g_string_append_c(((json_stream_capture_t *)iter->data)->text, c);
+
+  if(c == '{' || c == '[')
+  {
+    frame.type = c;
+    frame.index = -1;
+    frame.key = NULL;
+    frame.transparent = (c == '[' && !stream->frames->len);
+    frame.states = states;
+    g_array_append_val(stream->frames, frame);
+    stream->state = (c == '{')? JS_KEY : JS_VALUE;
+  }
+  else
+  {
+    g_array_unref(states);
+    stream->state = (c == '"')? JS_STRING : JS_LITERAL;
+  }
+}
+
+static void json_stream_value_end ( json_stream_t *stream )
+{
+  json_stream_capture_t *capture;
+  json_object *json;
+  GList *iter, *next;
+
+  for(iter=stream->captures; iter; iter=next)
+  {
+    next = g_list_next(iter);
+    capture = iter->data;
+    if(capture->depth != stream->frames->len)
+      continue;
+    if( (json = json_tokener_parse(capture->text->str)) )
+    {
+      stream->func(capture->target, json_object_get_string(json),
+          stream->data);
+      json_object_put(json);
+    }
+    json_stream_capture_free(capture);
+    stream->captures = g_list_delete_link(stream->captures, iter);
+  }
+
+  stream->state = stream->frames->len? JS_NEXT : JS_VALUE;
+}
+
+static gboolean json_stream_is_literal ( gchar c )
+{
+  return g_ascii_isalnum(c) || c=='-' || c=='+' || c=='.';
+}
+
+static void json_stream_key_char ( json_stream_t *stream, gchar c )
+{
+  json_stream_frame_t *frame;
+
+  /* keys are only compared against the path, \u escapes are kept as is */
+  if(stream->escape)
+  {
+    stream->escape = FALSE;
+    g_string_append_c(stream->key, c=='n'? '\n' : c=='t'? '\t' :
+        c=='r'? '\r' : c=='b'? '\b' : c=='f'? '\f' : c);
+  }
+  else if(c == '\\')
+    stream->escape = TRUE;
+  else if(c == '"')
+  {
+    frame = &g_array_index(stream->frames, json_stream_frame_t,
+        stream->frames->len-1);
+    g_free(frame->key);
+    frame->key = g_strndup(stream->key->str, stream->key->len);
+    g_string_truncate(stream->key, 0);
+    stream->state = JS_COLON;
+  }
+  else
+    g_string_append_c(stream->key, c);
+}
+
+static void json_stream_close ( json_stream_t *stream, gchar c )
+{
+  json_stream_frame_t *frame;
+
+  frame = &g_array_index(stream->frames, json_stream_frame_t,
+      stream->frames->len-1);
+  if(frame->type != (c == '}'? '{' : '['))
+  {
+    stream->state = JS_ERROR;
+    return;
+  }
+  json_stream_pop(stream);
+  json_stream_value_end(stream);
+}
+
+static void json_stream_char ( json_stream_t *stream, gchar c )
+{
+  json_stream_frame_t *frame;
+  GList *iter;
+
+  if(stream->state == JS_LITERAL && !json_stream_is_literal(c))
+    json_stream_value_end(stream);
+
+  if(stream->state == JS_ERROR)
+    return;
+
+  if(stream->state == JS_VALUE && !g_ascii_isspace(c) && c != ']')
+  {
+    if(c=='{' || c=='[' || c=='"' || json_stream_is_literal(c))
+      json_stream_value_start(stream, c);
+    else
+      stream->state = JS_ERROR;
+    return;
+  }
+
+  for(iter=stream->captures; iter; iter=g_list_next(iter))
+    g_string_append_c(((json_stream_capture_t *)iter->data)->text, c);
+
+  switch(stream->state)
+  {
+    case JS_STRING:
+      if(stream->escape)
+        stream->escape = FALSE;
+      else if(c == '\\')
+        stream->escape = TRUE;
+      else if(c == '"')
+        json_stream_value_end(stream);
+      break;
+    case JS_KEY_STRING:
+      json_stream_key_char(stream, c);
+      break;
+    case JS_LITERAL:
+      break;
+    default:
+      if(g_ascii_isspace(c))
+        break;
+      if(stream->state == JS_KEY && c == '"')
+        stream->state = JS_KEY_STRING;
+      else if(stream->state == JS_COLON && c == ':')
+        stream->state = JS_VALUE;
+      else if((stream->state == JS_KEY && c == '}') ||
+          ((stream->state == JS_VALUE || stream->state == JS_NEXT) &&
+           stream->frames->len && (c == ']' || c == '}')))
+        json_stream_close(stream, c);
+      else if(stream->state == JS_NEXT && c == ',')
+      {
+        frame = &g_array_index(stream->frames, json_stream_frame_t,
+            stream->frames->len-1);
+        stream->state = (frame->type == '{')? JS_KEY : JS_VALUE;
+      }
+      else
+        stream->state = JS_ERROR;
+      break;
+  }
+}
+
+void json_stream_feed ( json_stream_t *stream, const gchar *buf, gsize len )
+{
+  gsize i;
+
+  for(i=0; i<len && stream->state != JS_ERROR; i++)
+    json_stream_char(stream, buf[i]);
+}
+
+/* flush a trailing top level literal and reset the stream for the next
+ * document */
+void json_stream_finish ( json_stream_t *stream )
+{
+  if(stream->state == JS_LITERAL)
+    json_stream_value_end(stream);
+  json_stream_reset(stream);
+}
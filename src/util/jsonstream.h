@@ -0,0 +1,48 @@
+#ifndef __SFWBAR_JSONSTREAM_H__
+#define __SFWBAR_JSONSTREAM_H__
+
+#include <glib.h>
+#include "util/json.h"
+
+typedef void (*json_stream_func) ( gpointer target, const gchar *value,
+    gpointer data );
+
+typedef struct {
+  guint16 path;
+  guint16 step;
+  gboolean flat;
+} json_stream_state_t;
+
+typedef struct {
+  gchar type;
+  gint index;
+  gchar *key;
+  gboolean transparent;
+  GArray *states;
+} json_stream_frame_t;
+
+typedef struct {
+  gpointer target;
+  guint depth;
+  GString *text;
+} json_stream_capture_t;
+
+typedef struct {
+  GPtrArray *paths;
+  GPtrArray *targets;
+  json_stream_func func;
+  gpointer data;
+  GArray *frames;
+  GList *captures;
+  GString *key;
+  gint state;
+  gboolean escape;
+} json_stream_t;
+
+json_stream_t *json_stream_new ( json_stream_func func, gpointer data );
+void json_stream_free ( json_stream_t *stream );
+void json_stream_add ( json_stream_t *stream, jpath_t *path, gpointer target );
+void json_stream_feed ( json_stream_t *stream, const gchar *buf, gsize len );
+void json_stream_finish ( json_stream_t *stream );
+
+#endif
@@ -0,0 +1,119 @@
+/* This entire file is licensed under GNU General Public License v3.0
+ *
+ * Copyright 2025- sfwbar maintainers
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <unistd.h>
+#include "util/linereader.h"
+
+/* A line splitter over a reusable buffer. Lines are handed out as slices
+ * of the buffer, terminated in place. A slice is valid until the next call
+ * to line_reader_next. Unconsumed data is moved to the front of the buffer
+ * before each read and the buffer only grows if a single line doesn't fit */
+
+line_reader_t *line_reader_new ( gsize size )
+{
+  line_reader_t *reader;
+
+  reader = g_malloc0(sizeof(line_reader_t));
+  reader->size = MAX(size, 64);
+  reader->buf = g_malloc(reader->size + 1);
+
+  return reader;
+}
+
+void line_reader_free ( line_reader_t *reader )
+{
+  if(!reader)
+    return;
+
+  g_free(reader->buf);
+  g_free(reader);
+}
+
+void line_reader_reset ( line_reader_t *reader )
+{
+  reader->start = 0;
+  reader->end = 0;
+  reader->terminated = FALSE;
+}
+
+static void line_reader_restore ( line_reader_t *reader )
+{
+  if(!reader->terminated)
+    return;
+
+  reader->buf[reader->mark] = reader->saved;
+  reader->terminated = FALSE;
+}
+
+static GIOStatus line_reader_fill ( line_reader_t *reader, gint fd )
+{
+  gssize rlen;
+
+  if(reader->start)
+  {
+    memmove(reader->buf, reader->buf + reader->start,
+        reader->end - reader->start);
+    reader->end -= reader->start;
+    reader->start = 0;
+  }
+
+  if(reader->end == reader->size)
+  {
+    reader->size *= 2;
+    reader->buf = g_realloc(reader->buf, reader->size + 1);
+  }
+
+  do
+    rlen = read(fd, reader->buf + reader->end, reader->size - reader->end);
+  while(rlen<0 && errno==EINTR);
+
+  if(rlen>0)
+  {
+    reader->end += rlen;
+    return G_IO_STATUS_NORMAL;
+  }
+  if(!rlen)
+    return G_IO_STATUS_EOF;
+  if(errno==EAGAIN || errno==EWOULDBLOCK)
+    return G_IO_STATUS_AGAIN;
+  return G_IO_STATUS_ERROR;
+}
+
+GIOStatus line_reader_next ( line_reader_t *reader, gint fd, gchar **line,
+    gsize *len )
+{
+  GIOStatus status;
+  gchar *eol;
+  gsize stop;
+
+  line_reader_restore(reader);
+
+  while( !(eol = memchr(reader->buf + reader->start, '\n',
+          reader->end - reader->start)) )
+  {
+    status = line_reader_fill(reader, fd);
+    if(status == G_IO_STATUS_NORMAL)
+      continue;
+    /* flush a trailing line without a newline at the end of input */
+    if(status != G_IO_STATUS_EOF || reader->start == reader->end)
+      return status;
+    break;
+  }
+
+  stop = eol? eol - reader->buf + 1 : reader->end;
+
+  *line = reader->buf + reader->start;
+  *len = stop - reader->start;
+
+  reader->mark = stop;
+  reader->saved = reader->buf[stop];
+  reader->buf[stop] = '\0';
+  reader->terminated = TRUE;
+  reader->start = stop;
+
+  return G_IO_STATUS_NORMAL;
+}
@@ -0,0 +1,22 @@
+#ifndef __SFWBAR_LINEREADER_H__
+#define __SFWBAR_LINEREADER_H__
+
+#include <glib.h>
+
+typedef struct {
+  gchar *buf;
+  gsize size;
+  gsize start;
+  gsize end;
+  gsize mark;
+  gchar saved;
+  gboolean terminated;
+} line_reader_t;
+
+line_reader_t *line_reader_new ( gsize size );
+void line_reader_free ( line_reader_t *reader );
+void line_reader_reset ( line_reader_t *reader );
+GIOStatus line_reader_next ( line_reader_t *reader, gint fd, gchar **line,
+    gsize *len );
+
+#endif
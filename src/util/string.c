@@ -99,6 +99,42 @@ gchar *numeric_to_string ( double num, gint dec )
   return g_strdup(g_ascii_formatd(buf, G_ASCII_DTOSTR_BUF_SIZE, fbuf, num));
 }
 
+/* parse a decimal number from the first len characters of a string without
+ * copying it, anything more exotic is left to g_ascii_strtod */
+gdouble string_to_numeric ( const gchar *str, gsize len )
+{
+  const gchar *ptr = str, *end = str + len, *digits;
+  guint64 whole = 0, frac = 0;
+  gdouble scale = 1.0, result;
+  gboolean neg = FALSE;
+  gchar *copy;
+
+  while(ptr<end && g_ascii_isspace(*ptr))
+    ptr++;
+  if(ptr<end && (*ptr=='-' || *ptr=='+'))
+    neg = (*ptr++ == '-');
+
+  for(digits=ptr; ptr<end && g_ascii_isdigit(*ptr) && ptr-digits<18; ptr++)
+    whole = whole*10 + (*ptr - '0');
+  if(ptr<end && *ptr=='.')
+    for(digits=++ptr; ptr<end && g_ascii_isdigit(*ptr) && ptr-digits<18; ptr++)
+    {
+      frac = frac*10 + (*ptr - '0');
+      scale *= 10.0;
+    }
+
+  if(ptr<end && (g_ascii_isalnum(*ptr) || *ptr=='.'))
+  {
+    copy = g_strndup(str, len);
+    result = g_ascii_strtod(copy, NULL);
+    g_free(copy);
+    return result;
+  }
+
+  result = whole + frac/scale;
+  return neg? -result : result;
+}
+
 gboolean pattern_match ( gchar **dict, gchar *string )
 {
   gint i;
@@ -10,6 +10,7 @@ gchar *str_escape ( gchar *string );
 void *ptr_pass ( void *ptr );
 int md5_file( gchar *path, guchar output[16] );
 gchar *numeric_to_string ( double num, gint dec );
+gdouble string_to_numeric ( const gchar *str, gsize len );
 gboolean pattern_match ( gchar **dict, gchar *string );
 gboolean regex_match_list ( GList *dict, gchar *string );
 
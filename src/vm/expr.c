@@ -16,6 +16,12 @@
 #include "util/string.h"
 
 static GHashTable *expr_deps;
+static GRecMutex expr_dep_mutex;
+static GMutex expr_wait_mutex;
+static GCond expr_wait_cond;
+static gboolean expr_dirty;
+static GPrivate expr_dep_muted;
+static GQueue expr_dep_queue = G_QUEUE_INIT;
 
 /*
 static gdouble expr_parse_num ( GScanner *scanner, gdouble * );
@@ -792,17 +798,20 @@ gboolean expr_cache_eval ( expr_cache_t *expr )
   if(!expr || !expr->eval)
     return FALSE;
 
+  /* clear the flag first, so a change pushed during evaluation isn't lost */
   expr->vstate = FALSE;
+  expr->eval = FALSE;
+  g_atomic_int_set(&expr->pushed, FALSE);
   v1 = vm_expr_eval(expr);
   if(v1.type==EXPR_TYPE_STRING)
-    eval = v1.value.string;
+    eval = value_take_string(v1);
   else if(v1.type==EXPR_TYPE_NUMERIC)
     eval = numeric_to_string(v1.value.numeric, -1);
   else
     eval = g_strdup("");
 
-  if(!expr->vstate)
-    expr->eval = FALSE;
+  if(expr->vstate)
+    expr->eval = TRUE;
 
   g_debug("expr: '%s' = '%s', vstate: %d", expr->definition, eval,
       expr->vstate);
@@ -830,68 +839,206 @@ void expr_cache_free ( expr_cache_t *expr )
   if(!expr)
     return;
   expr_dep_remove(expr);
+  if(expr->dep_names)
+    g_ptr_array_free(expr->dep_names, TRUE);
+  g_list_free(expr->sources);
+  if(expr->memo)
+    g_hash_table_destroy(expr->memo);
   g_free(expr->definition);
   g_free(expr->cache);
   g_bytes_unref(expr->code);
   g_free(expr);
 }
 
-void expr_dep_add ( gchar *ident, expr_cache_t *expr )
+/* each variable name maps to a set of dependent expressions, and each
+ * expression keeps the sets it was added to, so it can be removed without
+ * walking the whole table. The sets are kept when they become empty */
+static GHashTable *expr_dep_set ( const gchar *vname, gboolean create )
+{
+  GHashTable *set;
+
+  if(!expr_deps)
+  {
+    if(!create)
+      return NULL;
+    expr_deps = g_hash_table_new_full((GHashFunc)str_nhash,
+          (GEqualFunc)str_nequal, g_free, (GDestroyNotify)g_hash_table_destroy);
+  }
+
+  if( !(set = g_hash_table_lookup(expr_deps, vname)) && create)
+  {
+    set = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_hash_table_insert(expr_deps, g_strdup(vname), set);
+  }
+
+  return set;
+}
+
+/* add a dependency on a bare variable name (no '$' prefix or field) */
+void expr_dep_add_var ( const gchar *vname, expr_cache_t *expr )
 {
-  GList *list;
+  GHashTable *set;
   expr_cache_t *iter;
-  gchar *vname;
 
   if(!expr)
     return;
 
-  if(!expr_deps)
-    expr_deps = g_hash_table_new_full((GHashFunc)str_nhash,
-          (GEqualFunc)str_nequal, g_free, NULL);
+  g_rec_mutex_lock(&expr_dep_mutex);
+  set = expr_dep_set(vname, TRUE);
+  for(iter=expr; iter; iter=iter->parent)
+    if(g_hash_table_add(set, iter))
+    {
+      if(!iter->deps)
+        iter->deps = g_ptr_array_new();
+      g_ptr_array_add(iter->deps, set);
+    }
+  g_rec_mutex_unlock(&expr_dep_mutex);
+}
+
+/* add a dependency on an interned variable (or function) name from the vm.
+ * An expression records the names it has registered, so only the first
+ * evaluation reading a variable or calling a function takes the dependency
+ * lock */
+void expr_dep_add_once ( const gchar *vname, expr_cache_t *expr )
+{
+  guint i;
+
+  if(!expr)
+    return;
+
+  if(expr->dep_names)
+    for(i=0; i<expr->dep_names->len; i++)
+      if(g_ptr_array_index(expr->dep_names, i) == vname)
+        return;
+
+  if(!expr->dep_names)
+    expr->dep_names = g_ptr_array_new();
+  g_ptr_array_add(expr->dep_names, (gpointer)vname);
+  expr_dep_add_var(vname, expr);
+}
+
+void expr_dep_add ( gchar *ident, expr_cache_t *expr )
+{
+  gchar *vname;
+
+  if(!expr)
+    return;
 
   vname = scanner_parse_identifier(ident, NULL);
-  list = g_hash_table_lookup(expr_deps, vname);
-  for(iter=expr; iter; iter=iter->parent)
-    if(!g_list_find(list, iter))
-      list = g_list_prepend(list, iter);
-  g_hash_table_replace(expr_deps, vname, list);
+  expr_dep_add_var(vname, expr);
+  g_free(vname);
 }
 
 void expr_dep_remove ( expr_cache_t *expr )
 {
-  GHashTableIter hiter;
-  void *list, *key;
+  guint i;
 
-  if(!expr_deps)
+  if(!expr || !expr->deps)
     return;
 
-  g_hash_table_iter_init(&hiter, expr_deps);
-  while(g_hash_table_iter_next(&hiter, &key, &list))
-    g_hash_table_iter_replace(&hiter, g_list_remove(list, expr));
+  g_rec_mutex_lock(&expr_dep_mutex);
+  for(i=0; i<expr->deps->len; i++)
+    g_hash_table_remove(g_ptr_array_index(expr->deps, i), expr);
+  g_clear_pointer(&expr->deps, g_ptr_array_unref);
+  if(expr->queue)
+    g_queue_remove_all(&expr_dep_queue, expr);
+  g_rec_mutex_unlock(&expr_dep_mutex);
 }
 
+/* mark the dependents of a variable for evaluation. The pushed flag
+ * records a change since the last evaluation, unlike eval it is never left
+ * set by a volatile expression. An expression that defines a variable (a Set
+ * variable) passes the change on to its own dependents when it is pushed.
+ * Expressions flagged with queue are also queued for expr_dep_next */
 void expr_dep_trigger ( gchar *ident )
 {
-  GList *iter,*list;
+  GHashTableIter hiter;
+  GHashTable *set;
+  expr_cache_t *expr;
+  gboolean dirty = FALSE;
 
-  if(!expr_deps)
-    return;
+  g_rec_mutex_lock(&expr_dep_mutex);
+  if( (set = expr_dep_set(ident, FALSE)) )
+  {
+    g_hash_table_iter_init(&hiter, set);
+    while(g_hash_table_iter_next(&hiter, (gpointer *)&expr, NULL))
+    {
+      expr->eval = TRUE;
+      if(g_atomic_int_compare_and_exchange(&expr->pushed, FALSE, TRUE))
+      {
+        dirty = TRUE;
+        if(expr->queue)
+          g_queue_push_tail(&expr_dep_queue, expr);
+        if(expr->name)
+          expr_dep_trigger((gchar *)expr->name);
+      }
+    }
+  }
+  g_rec_mutex_unlock(&expr_dep_mutex);
+
+  if(dirty && !g_private_get(&expr_dep_muted))
+    expr_dep_notify();
+}
+
+/* take the next queued expression with a pushed change, an expression is
+ * removed from the queue when its dependencies are removed */
+expr_cache_t *expr_dep_next ( void )
+{
+  expr_cache_t *expr;
+
+  g_rec_mutex_lock(&expr_dep_mutex);
+  expr = g_queue_pop_head(&expr_dep_queue);
+  g_rec_mutex_unlock(&expr_dep_mutex);
+
+  return expr;
+}
+
+/* changes published by the polling threads themselves don't wake the
+ * scanner, the expressions they mark are evaluated on their next poll */
+void expr_dep_mute ( gboolean mute )
+{
+  g_private_set(&expr_dep_muted, GINT_TO_POINTER(mute));
+}
+
+/* wake up a thread waiting in expr_dep_wait */
+void expr_dep_notify ( void )
+{
+  g_mutex_lock(&expr_wait_mutex);
+  expr_dirty = TRUE;
+  g_cond_signal(&expr_wait_cond);
+  g_mutex_unlock(&expr_wait_mutex);
+}
 
-  list = g_hash_table_lookup(expr_deps, ident);
+/* wait until an expression is marked for evaluation or the (monotonic)
+ * end time is reached, returns TRUE if woken by a change */
+gboolean expr_dep_wait ( gint64 end_time )
+{
+  gboolean dirty;
+
+  g_mutex_lock(&expr_wait_mutex);
+  while(!expr_dirty)
+    if(!g_cond_wait_until(&expr_wait_cond, &expr_wait_mutex, end_time))
+      break;
+  dirty = expr_dirty;
+  expr_dirty = FALSE;
+  g_mutex_unlock(&expr_wait_mutex);
 
-  for(iter=list; iter; iter=g_list_next(iter))
-    ((expr_cache_t *)(iter->data))->eval = TRUE;
+  return dirty;
 }
 
 void expr_dep_dump_each ( void *key, void *value, void *d )
 {
-  GList *iter;
+  GHashTableIter hiter;
+  gpointer expr;
 
-  for(iter=value;iter;iter=g_list_next(iter))
-    g_message("%s: %s", (gchar *)key, ((expr_cache_t *)iter->data)->definition);
+  g_hash_table_iter_init(&hiter, value);
+  while(g_hash_table_iter_next(&hiter, &expr, NULL))
+    g_message("%s: %s", (gchar *)key, ((expr_cache_t *)expr)->definition);
 }
 
 void expr_dep_dump ( void )
 {
+  g_rec_mutex_lock(&expr_dep_mutex);
   g_hash_table_foreach(expr_deps,expr_dep_dump_each,NULL);
+  g_rec_mutex_unlock(&expr_dep_mutex);
 }
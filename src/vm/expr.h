@@ -10,8 +10,15 @@ typedef struct expr_cache {
   GtkWidget *widget;
   GdkEvent *event;
   gboolean eval;
+  gboolean pushed;
+  gboolean queue;
   gint stack_depth;
   guint vstate;
+  GList *sources;
+  GPtrArray *deps;
+  GPtrArray *dep_names;
+  GHashTable *memo;
+  const gchar *name;
   struct expr_cache *parent;
 } expr_cache_t;
 
@@ -21,8 +28,14 @@ expr_cache_t *expr_cache_new ( void );
 void expr_cache_set ( expr_cache_t *expr, gchar *def );
 void expr_cache_free ( expr_cache_t *expr );
 void expr_dep_add ( gchar *ident, expr_cache_t *expr );
+void expr_dep_add_var ( const gchar *vname, expr_cache_t *expr );
+void expr_dep_add_once ( const gchar *vname, expr_cache_t *expr );
 void expr_dep_remove ( expr_cache_t *expr );
 void expr_dep_trigger ( gchar *ident );
+expr_cache_t *expr_dep_next ( void );
+void expr_dep_notify ( void );
+void expr_dep_mute ( gboolean mute );
+gboolean expr_dep_wait ( gint64 end_time );
 void expr_dep_dump ( void );
 
 #endif
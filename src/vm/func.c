@@ -20,7 +20,7 @@ vm_function_t *vm_func_lookup ( gchar *name )
     return func;
 
   func = g_malloc0(sizeof(vm_function_t));
-  func->name = g_strdup(name);
+  func->name = (gchar *)g_intern_string(name);
   g_hash_table_insert(vm_func_table, func->name, func);
 
   return func;
@@ -33,7 +33,7 @@ void vm_func_add ( gchar *name, vm_func_t function, gboolean deterministic )
   func = vm_func_lookup(name);
 
   func->ptr.function = function;
-  func->flags |= (deterministic? VM_FUNC_DETERMINISTIC : 0);
+  func->flags = (deterministic? VM_FUNC_DETERMINISTIC : 0);
   expr_dep_trigger(name);
   g_debug("function: registered '%s'", name);
 }
@@ -1,5 +1,6 @@
 
 #include "config/config.h"
+#include "scanner.h"
 #include "util/string.h"
 #include "vm/vm.h"
 
@@ -55,6 +56,84 @@ static void parser_emit_na ( GByteArray *code )
   g_byte_array_append(code, data, sizeof(value_t)+1);
 }
 
+static gsize parser_immediate_len ( GByteArray *code, gsize pos )
+{
+  if(code->data[pos+1] == EXPR_TYPE_STRING)
+    return strlen((gchar *)code->data+pos+2) + 3;
+  return sizeof(value_t) + 1;
+}
+
+/* check if code from start is a single immediate and get it's value */
+static gboolean parser_immediate_get ( GByteArray *code, gsize start,
+    value_t *value )
+{
+  if(start >= code->len || code->data[start] != EXPR_OP_IMMEDIATE ||
+      start + parser_immediate_len(code, start) != code->len)
+    return FALSE;
+
+  if(code->data[start+1] == EXPR_TYPE_STRING)
+    *value = value_new_string_static(code->data+start+2);
+  else
+    memcpy(value, code->data+start+1, sizeof(value_t));
+
+  return TRUE;
+}
+
+/* check if code from start only has immediates, operators and calls to
+ * deterministic functions and can be evaluated at compile time */
+static gboolean parser_is_constant ( GByteArray *code, gsize start )
+{
+  vm_function_t *func;
+  gsize i = start;
+  gint n = 0;
+
+  while(i < code->len)
+  {
+    if(code->data[i] == EXPR_OP_IMMEDIATE)
+      i += parser_immediate_len(code, i);
+    else if(code->data[i] == EXPR_OP_FUNCTION)
+    {
+      memcpy(&func, code->data+i+2, sizeof(gpointer));
+      if(!func || (func->flags & VM_FUNC_USERDEFINED) ||
+          !(func->flags & VM_FUNC_DETERMINISTIC) || !func->ptr.function)
+        return FALSE;
+      i += EXPR_FUNCTION_LEN;
+    }
+    else if(code->data[i] >= EXPR_OP_ADD && code->data[i] <= EXPR_OP_NEG)
+      i++;
+    else
+      return FALSE;
+    n++;
+  }
+
+  return n>1;
+}
+
+/* fold a constant expression into a single immediate */
+static void parser_fold ( GByteArray *code, gsize start )
+{
+  value_t value;
+
+  if(!parser_is_constant(code, start))
+    return;
+
+  value = value_persist(vm_code_eval(code->data + start, code->len - start));
+  if(value_is_array(value))
+  {
+    value_free(value);
+    return;
+  }
+
+  g_byte_array_set_size(code, start);
+  if(value_is_string(value))
+    parser_emit_string(code, (gchar *)value_get_string(value));
+  else if(value_is_numeric(value))
+    parser_emit_numeric(code, value_get_numeric(value));
+  else
+    parser_emit_na(code);
+  value_free(value);
+}
+
 static void parser_jump_backpatch ( GByteArray *code, gint olen, gint clen )
 {
   gint data = clen - olen - sizeof(gint);
@@ -104,8 +183,35 @@ static gboolean parser_cached ( GScanner *scanner, GByteArray *code )
   return TRUE;
 }
 
+static gboolean parser_if_constant ( GScanner *scanner, GByteArray *code,
+    gsize start, value_t cond )
+{
+  gsize tlen;
+
+  g_byte_array_set_size(code, start);
+  if(!parser_expr_parse(scanner, code))
+    return FALSE;
+  if(g_scanner_get_next_token(scanner)!=',')
+    return FALSE;
+  tlen = code->len;
+  if(!parser_expr_parse(scanner, code))
+    return FALSE;
+  if(g_scanner_get_next_token(scanner)!=')')
+    return FALSE;
+
+  /* jumps are relative, so the surviving branch can be moved as is */
+  if(value_is_numeric(cond) && cond.value.numeric)
+    g_byte_array_set_size(code, tlen);
+  else
+    g_byte_array_remove_range(code, start, tlen - start);
+
+  return TRUE;
+}
+
 static gboolean parser_if ( GScanner *scanner, GByteArray *code )
 {
+  value_t cond;
+  gsize start = code->len;
   gint alen;
 
   if(g_scanner_get_next_token(scanner)!='(')
@@ -115,6 +221,9 @@ static gboolean parser_if ( GScanner *scanner, GByteArray *code )
   if(g_scanner_get_next_token(scanner)!=',')
     return FALSE;
 
+  if(parser_immediate_get(code, start, &cond))
+    return parser_if_constant(scanner, code, start, cond);
+
   alen = parser_emit_jump(code, EXPR_OP_JZ);
 
   if(!parser_expr_parse(scanner, code))
@@ -137,19 +246,25 @@ static gboolean parser_if ( GScanner *scanner, GByteArray *code )
   return TRUE;
 }
 
-static void parser_emit_function ( GByteArray *code, const void *f, guint8 np )
+/* last is the offset of the code of the last parameter, so actions like
+ * SetValue can extract the expression they were given */
+static void parser_emit_function ( GByteArray *code, const void *f, guint8 np,
+    gsize last )
 {
-  guint8 data[sizeof(gpointer)+2];
+  guint8 data[EXPR_FUNCTION_LEN];
+  gint alen = np? code->len - last : 0;
 
-  memcpy(data+2, &f, sizeof(gpointer));
   data[0]=EXPR_OP_FUNCTION;
   data[1]=np;
-  g_byte_array_append(code, data, sizeof(gpointer)+2);
+  memcpy(data+2, &f, sizeof(gpointer));
+  memcpy(data+2+sizeof(gpointer), &alen, sizeof(gint));
+  g_byte_array_append(code, data, EXPR_FUNCTION_LEN);
 }
 
 static gboolean parser_function ( GScanner *scanner, GByteArray *code )
 {
   gconstpointer ptr;
+  gsize start = code->len, last = code->len;
   guint8 np;
 
   if(!g_ascii_strcasecmp(scanner->value.v_identifier, "ident"))
@@ -162,6 +277,7 @@ static gboolean parser_function ( GScanner *scanner, GByteArray *code )
   if(g_scanner_peek_next_token(scanner)!=')')
     do
     {
+      last = code->len;
       if(!parser_expr_parse(scanner, code))
         return FALSE;
       np++;
@@ -172,7 +288,8 @@ static gboolean parser_function ( GScanner *scanner, GByteArray *code )
   if(scanner->token != ')')
     return FALSE;
 
-  parser_emit_function(code, ptr, np);
+  parser_emit_function(code, ptr, np, last);
+  parser_fold(code, start);
   scanner->config->identifier_2_string = FALSE;
 
   return TRUE;
@@ -180,31 +297,36 @@ static gboolean parser_function ( GScanner *scanner, GByteArray *code )
 
 static gboolean parser_variable ( GScanner *scanner, GByteArray *code )
 {
-  guint8 data[sizeof(gpointer)+1];
-  gconstpointer ptr;
+  guint8 data[sizeof(gpointer)+3];
+  ScanRef *ref;
   guint16 pos;
+  gsize last;
 
   if( (pos = parser_local_lookup(scanner)) )
   {
     if(config_check_and_consume(scanner, '['))
     {
       parser_emit_local(code, pos, EXPR_OP_LOCAL);
+      last = code->len;
       if(!parser_expr_parse(scanner, code))
         return FALSE;
       if(!config_expect_token(scanner, ']', "Expect ']' after array index"))
         return FALSE;
 
-      parser_emit_function(code, vm_func_lookup("arrayindex"), 2);
+      parser_emit_function(code, vm_func_lookup("arrayindex"), 2, last);
     }
     else
       parser_emit_local(code, pos, EXPR_OP_LOCAL);
     return TRUE;
   }
 
-  ptr = parser_identifier_lookup(scanner->value.v_identifier);
-  memcpy(data+1, &ptr, sizeof(gpointer));
-  data[0] = EXPR_OP_VARIABLE;
-  g_byte_array_append(code, data, sizeof(gpointer)+1);
+  ref = scanner_ref_get(parser_identifier_lookup(
+        scanner->value.v_identifier));
+  data[0] = EXPR_OP_SCANVAR;
+  memcpy(data+1, &ref->slot, sizeof(gpointer));
+  data[sizeof(gpointer)+1] = ref->field;
+  data[sizeof(gpointer)+2] = ref->string;
+  g_byte_array_append(code, data, sizeof(gpointer)+3);
 
   return TRUE;
 }
@@ -245,9 +367,11 @@ static gboolean parser_identifier ( GScanner *scanner, GByteArray *code )
 static gboolean parser_array_handle ( GScanner *scanner, GByteArray *code )
 {
   guint8 np = 0;
+  gsize last = code->len;
 
   if(g_scanner_peek_next_token(scanner)!=']')
     do {
+      last = code->len;
       if(!parser_expr_parse(scanner, code))
         return FALSE;
       np++;
@@ -256,13 +380,14 @@ static gboolean parser_array_handle ( GScanner *scanner, GByteArray *code )
   if(!config_expect_token(scanner, ']', "Expected ']' at the end of the list"))
     return FALSE;
 
-  parser_emit_function(code, vm_func_lookup("arraybuild"), np);
+  parser_emit_function(code, vm_func_lookup("arraybuild"), np, last);
 
   return TRUE;
 }
 
 static gboolean parser_value ( GScanner *scanner, GByteArray *code )
 {
+  gsize start = code->len;
   guchar data;
   gint token;
 
@@ -284,17 +409,18 @@ static gboolean parser_value ( GScanner *scanner, GByteArray *code )
   {
     if(!parser_value(scanner, code))
       return FALSE;
-    parser_emit_numeric(code, -1);
-    data = '*';
+    data = EXPR_OP_NEG;
     g_byte_array_append(code, &data, 1);
+    parser_fold(code, start);
     return TRUE;
   }
   else if(token == '!')
   {
     if(!parser_value(scanner, code))
       return FALSE;
-    data = '!';
+    data = EXPR_OP_NOT;
     g_byte_array_append(code, &data, 1);
+    parser_fold(code, start);
     return TRUE;
   }
   else if(token == '(')
@@ -306,12 +432,41 @@ static gboolean parser_value ( GScanner *scanner, GByteArray *code )
   return TRUE;
 }
 
+static guchar parser_op_lookup ( guchar op, gboolean or_equal )
+{
+  switch(op)
+  {
+    case '+':
+      return EXPR_OP_ADD;
+    case '-':
+      return EXPR_OP_SUB;
+    case '*':
+      return EXPR_OP_MUL;
+    case '/':
+      return EXPR_OP_DIV;
+    case '%':
+      return EXPR_OP_MOD;
+    case '&':
+      return EXPR_OP_AND;
+    case '|':
+      return EXPR_OP_OR;
+    case '<':
+      return or_equal? EXPR_OP_LE : EXPR_OP_LT;
+    case '>':
+      return or_equal? EXPR_OP_GE : EXPR_OP_GT;
+    case '=':
+      return EXPR_OP_EQ;
+    default:
+      return EXPR_OP_NE;
+  }
+}
+
 static gboolean parser_ops ( GScanner *scanner, GByteArray *code, gint l )
 {
   static gchar *expr_ops_list[] = { "&|", "!<>=", "+-", "*/%", NULL };
-  static const guchar *ne = (guchar *)"=!", equal = '=';
+  gsize start = code->len;
   gboolean or_equal;
-  guchar op;
+  guchar op, data;
 
   if(!expr_ops_list[l])
     return parser_value(scanner, code);
@@ -339,13 +494,9 @@ static gboolean parser_ops ( GScanner *scanner, GByteArray *code, gint l )
     if(!parser_ops(scanner, code, l+1))
       return FALSE;
 
-    if(op!='!')
-      g_byte_array_append(code, &op, 1);
-    else
-      g_byte_array_append(code, ne, 2);
-
-    if(or_equal)
-      g_byte_array_append(code, &equal, 1);
+    data = parser_op_lookup(op, or_equal);
+    g_byte_array_append(code, &data, 1);
+    parser_fold(code, start);
   }
   return TRUE;
 }
@@ -390,6 +541,7 @@ gboolean parser_macro_add ( GScanner *scanner )
 static gboolean parser_assign_parse ( GScanner *scanner, GByteArray *code )
 {
   guint16 pos;
+  gsize last;
 
   if(!(pos = parser_local_lookup(scanner)) )
     return FALSE;
@@ -403,9 +555,10 @@ static gboolean parser_assign_parse ( GScanner *scanner, GByteArray *code )
       return FALSE;
     if(!config_expect_token(scanner, '=', "Expect '=' after a variable"))
       return FALSE;
+    last = code->len;
     if(!parser_expr_parse(scanner, code))
       return FALSE;
-    parser_emit_function(code, vm_func_lookup("arrayassign"), 3);
+    parser_emit_function(code, vm_func_lookup("arrayassign"), 3, last);
     parser_emit_local(code, pos, EXPR_OP_ASSIGN);
     config_check_and_consume(scanner, ';');
     return TRUE;
@@ -428,6 +581,7 @@ static gboolean parser_action_parse ( GScanner *scanner, GByteArray *code )
   gboolean neg;
   static guint8 discard = EXPR_OP_DISCARD;
   gint alen, flag, cond = 0, np = 0;
+  gsize last = code->len;
 
   if(config_check_and_consume(scanner, '['))
   {
@@ -451,9 +605,10 @@ static gboolean parser_action_parse ( GScanner *scanner, GByteArray *code )
   if(cond)
   {
     parser_emit_numeric(code, cond & 0xff);
+    last = code->len;
     parser_emit_numeric(code, cond>>8);
 
-    parser_emit_function(code, vm_func_lookup("checkstate"), 2);
+    parser_emit_function(code, vm_func_lookup("checkstate"), 2, last);
     alen = parser_emit_jump(code, EXPR_OP_JZ);
   }
 
@@ -481,6 +636,7 @@ static gboolean parser_action_parse ( GScanner *scanner, GByteArray *code )
   {
     do
     {
+      last = code->len;
       if(parser_expr_parse(scanner, code))
         np++;
     } while(config_check_and_consume(scanner, ','));
@@ -488,7 +644,7 @@ static gboolean parser_action_parse ( GScanner *scanner, GByteArray *code )
 
   config_check_and_consume(scanner, ';');
 
-  parser_emit_function(code, ptr, np);
+  parser_emit_function(code, ptr, np, last);
 
   if(cond)
   {
@@ -3,8 +3,10 @@
 
 void value_free ( value_t v1 )
 {
-  if(value_is_string(v1))
+  if(value_is_string(v1) && v1.storage == VALUE_STORAGE_OWNED)
     g_free(v1.value.string);
+  else if(value_is_string(v1) && v1.storage == VALUE_STORAGE_REF)
+    g_ref_string_release(v1.value.string);
   else if(value_is_array(v1))
     g_array_unref(v1.value.array);
 }
@@ -44,9 +46,65 @@ value_t value_dup_array ( value_t v1 )
 
 value_t value_dup ( value_t v1 )
 {
-  if(value_is_string(v1))
+  if(value_is_string(v1) && v1.storage == VALUE_STORAGE_REF)
+    return value_new_string_ref(g_ref_string_acquire(v1.value.string));
+  if(value_is_string(v1) && v1.storage == VALUE_STORAGE_OWNED)
     return value_new_string(g_strdup(v1.value.string));
   if(value_is_array(v1))
     return value_dup_array(v1);
   return v1;
 }
+
+/* convert an owned string into a refcounted one, so the value can be
+ * duplicated without copying */
+value_t value_share ( value_t v1 )
+{
+  gchar *str;
+
+  if(!value_is_string(v1) || v1.storage != VALUE_STORAGE_OWNED ||
+      !v1.value.string)
+    return v1;
+
+  str = g_ref_string_new(v1.value.string);
+  g_free(v1.value.string);
+  return value_new_string_ref(str);
+}
+
+/* make a value safe to keep after the code it came from is gone */
+value_t value_persist ( value_t v1 )
+{
+  guint i;
+
+  if(value_is_string(v1) && v1.storage == VALUE_STORAGE_STATIC)
+    return value_new_string(g_strdup(v1.value.string));
+  if(value_is_array(v1))
+    for(i=0; i<v1.value.array->len; i++)
+      g_array_index(v1.value.array, value_t, i) =
+        value_persist(g_array_index(v1.value.array, value_t, i));
+  return v1;
+}
+
+/* consume a string value and return it as a string owned by the caller */
+gchar *value_take_string ( value_t v1 )
+{
+  gchar *str;
+
+  if(value_is_string(v1) && v1.storage == VALUE_STORAGE_OWNED)
+    return v1.value.string;
+
+  str = g_strdup(value_get_string(v1));
+  value_free(v1);
+  return str;
+}
+
+/* arrays are never considered equal */
+gboolean value_equal ( value_t v1, value_t v2 )
+{
+  if(v1.type != v2.type || value_is_array(v1))
+    return FALSE;
+  if(value_is_string(v1))
+    return !g_strcmp0(v1.value.string, v2.value.string);
+  if(value_is_numeric(v1))
+    return v1.value.numeric == v2.value.numeric;
+  return TRUE;
+}
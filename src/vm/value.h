@@ -11,8 +11,18 @@ enum expr_type_t {
   EXPR_TYPE_NA
 };
 
+/* string ownership: owned strings are freed with the value, static strings
+ * are borrowed from the bytecode and are only valid while it runs, ref
+ * strings are GRefStrings shared between values */
+enum value_storage_t {
+  VALUE_STORAGE_OWNED,
+  VALUE_STORAGE_STATIC,
+  VALUE_STORAGE_REF
+};
+
 typedef struct {
   guint8 type;
+  guint8 storage;
   union {
     gboolean boolean;
     gdouble numeric;
@@ -25,6 +35,10 @@ extern const value_t value_na;
 
 #define value_new_string(v) \
   ((value_t){.type=EXPR_TYPE_STRING, .value.string=(v)})
+#define value_new_string_static(v) ((value_t){.type=EXPR_TYPE_STRING, \
+    .storage=VALUE_STORAGE_STATIC, .value.string=(gchar *)(v)})
+#define value_new_string_ref(v) ((value_t){.type=EXPR_TYPE_STRING, \
+    .storage=VALUE_STORAGE_REF, .value.string=(v)})
 #define value_new_numeric(v) \
   ((value_t){.type=EXPR_TYPE_NUMERIC, .value.numeric=(v)})
 #define value_new_array(v) \
@@ -50,6 +64,10 @@ extern const value_t value_na;
 
 void value_free ( value_t );
 value_t value_dup ( value_t );
+value_t value_share ( value_t v1 );
+value_t value_persist ( value_t v1 );
+gchar *value_take_string ( value_t v1 );
+gboolean value_equal ( value_t v1, value_t v2 );
 value_t value_array_concat ( value_t v1, value_t v2 );
 
 #endif
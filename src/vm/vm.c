@@ -1,29 +1,99 @@
+#include <math.h>
 
 #include "expr.h"
 #include "scanner.h"
 #include "module.h"
 #include "gui/taskbaritem.h"
 
+typedef struct {
+  GPtrArray *stacks;
+  guint depth;
+} vm_context_t;
+
+typedef struct {
+  vm_function_t *func;
+  guint8 np;
+  value_t *params;
+  value_t result;
+} vm_memo_t;
+
 const value_t value_na = { .type = EXPR_TYPE_NA };
 static value_t vm_run ( vm_t *vm, guint8 np );
 
-static void vm_push ( vm_t *vm, value_t val )
+static void vm_stack_free ( vm_stack_t *stack )
 {
-  g_array_append_val(vm->stack, val);
-  vm->max_stack = MAX(vm->max_stack, vm->stack->len);
+  while(stack->len)
+    value_free(stack->data[--stack->len]);
+  g_free(stack->data);
+  g_free(stack);
 }
 
-static value_t vm_pop ( vm_t *vm )
+static void vm_context_free ( vm_context_t *ctx )
 {
-  value_t val;
+  g_ptr_array_free(ctx->stacks, TRUE);
+  g_free(ctx);
+}
 
-  if(!vm->stack->len)
-    return value_na;
+static GPrivate vm_context = G_PRIVATE_INIT((GDestroyNotify)vm_context_free);
 
-  val = ((value_t *)(vm->stack->data))[vm->stack->len-1];
-  g_array_remove_index(vm->stack, vm->stack->len-1);
+static void vm_stack_reserve ( vm_stack_t *stack, gsize size )
+{
+  if(size <= stack->size)
+    return;
+  stack->size = MAX(size, MAX(stack->size*2, 16));
+  stack->data = g_renew(value_t, stack->data, stack->size);
+}
+
+/* each thread keeps one stack per nesting level (a scanner variable may
+ * evaluate its own expression while another is running), the stacks are
+ * reused between evaluations, so a nested evaluation never moves the data
+ * of a running one */
+static vm_stack_t *vm_stack_acquire ( gsize size )
+{
+  vm_context_t *ctx;
+  vm_stack_t *stack;
+
+  if( !(ctx = g_private_get(&vm_context)) )
+  {
+    ctx = g_malloc0(sizeof(vm_context_t));
+    ctx->stacks = g_ptr_array_new_with_free_func(
+        (GDestroyNotify)vm_stack_free);
+    g_private_set(&vm_context, ctx);
+  }
+
+  if(ctx->depth >= ctx->stacks->len)
+  {
+    stack = g_malloc0(sizeof(vm_stack_t));
+    g_ptr_array_add(ctx->stacks, stack);
+  }
+  stack = g_ptr_array_index(ctx->stacks, ctx->depth++);
+  vm_stack_reserve(stack, MAX(1, size));
 
-  return val;
+  return stack;
+}
+
+static void vm_stack_release ( void )
+{
+  vm_context_t *ctx;
+
+  if( (ctx = g_private_get(&vm_context)) && ctx->depth)
+    ctx->depth--;
+}
+
+static inline void vm_push ( vm_t *vm, value_t val )
+{
+  if(G_UNLIKELY(vm->stack->len >= vm->stack->size))
+    vm_stack_reserve(vm->stack, vm->stack->len+1);
+  vm->stack->data[vm->stack->len++] = val;
+  vm->max_stack = MAX(vm->max_stack, vm->stack->len);
+}
+
+static inline value_t vm_pop ( vm_t *vm )
+{
+  if(G_UNLIKELY(!vm->stack->len))
+    return value_na;
+
+  return vm->stack->data[--vm->stack->len];
 }
 
 static void vm_stack_unwind ( vm_t *vm, gsize target )
@@ -37,82 +107,187 @@ static void vm_stack_unwind ( vm_t *vm, gsize target )
   }
 }
 
-static gboolean vm_op_binary ( vm_t *vm )
+/* numeric operands are handled in place on the stack */
+static inline gdouble vm_op_numeric ( guint8 op, gdouble a, gdouble b )
 {
-  value_t v1, v2, result;
-  guchar op = *(vm->ip);
+  switch(op)
+  {
+    case EXPR_OP_ADD:
+      return a + b;
+    case EXPR_OP_SUB:
+      return a - b;
+    case EXPR_OP_MUL:
+      return a * b;
+    case EXPR_OP_DIV:
+      return a / b;
+    case EXPR_OP_MOD:
+      return (gint)b? (gint)a % (gint)b : NAN;
+    case EXPR_OP_AND:
+      return a && b;
+    case EXPR_OP_OR:
+      return a || b;
+    case EXPR_OP_LT:
+      return a < b;
+    case EXPR_OP_GT:
+      return a > b;
+    case EXPR_OP_LE:
+      return a <= b;
+    case EXPR_OP_GE:
+      return a >= b;
+    case EXPR_OP_EQ:
+      return a == b;
+    case EXPR_OP_NE:
+      return a != b;
+  }
+  return 0;
+}
 
-  if(!strchr("+-*/%=<>!&|", op) || vm->stack->len<2)
-    return FALSE;
+/* concatenate two strings, consuming v1, an owned left operand is
+ * extended in place */
+static value_t vm_op_concat ( value_t v1, value_t v2 )
+{
+  value_t result;
+  gsize l1, l2;
 
-  v2 = vm_pop(vm);
-  v1 = vm_pop(vm);
+  if(!value_is_string(v1) || v1.storage != VALUE_STORAGE_OWNED ||
+      !v1.value.string)
+  {
+    result = value_new_string(
+        g_strconcat(value_get_string(v1), value_get_string(v2), NULL));
+    value_free(v1);
+    return result;
+  }
 
-  result = value_na;
+  l1 = strlen(v1.value.string);
+  l2 = strlen(value_get_string(v2));
+  v1.value.string = g_realloc(v1.value.string, l1 + l2 + 1);
+  memcpy(v1.value.string + l1, value_get_string(v2), l2 + 1);
 
-  if(value_is_na(v1) && value_is_na(v2))
-    result = value_na;
+  return v1;
+}
 
-  else if(value_is_array(v1) || value_is_array(v2))
-    result = value_array_concat(v1, v2);
+static void vm_op_binary ( vm_t *vm, guint8 op )
+{
+  value_t v1, v2, *s;
 
-  else if(value_like_string(v1) && value_like_string(v2))
+  s = vm->stack->data + vm->stack->len - 2;
+  if(G_LIKELY(value_is_numeric(s[0]) && value_is_numeric(s[1])))
   {
-    if(op == '+')
-      result = value_new_string(
-          g_strconcat(value_get_string(v1), value_get_string(v2), NULL));
-    else if(op == '=')
-      result = value_new_numeric(
-          !g_ascii_strcasecmp(value_get_string(v1), value_get_string(v2)));
-    else if(op == '!')
-      result = value_new_numeric(
-          g_ascii_strcasecmp(value_get_string(v1), value_get_string(v2)));
+    s[0].value.numeric = vm_op_numeric(op, s[0].value.numeric,
+        s[1].value.numeric);
+    vm->stack->len--;
+    return;
   }
 
-  else if(value_like_numeric(v1) && value_like_numeric(v2))
-  {
-    if(op=='+')
-      result = value_new_numeric(value_get_numeric(v1)+value_get_numeric(v2));
-    else if(op=='-')
-      result = value_new_numeric(value_get_numeric(v1)-value_get_numeric(v2));
-    else if(op=='*')
-      result = value_new_numeric(value_get_numeric(v1)*value_get_numeric(v2));
-    else if(op=='/')
-      result = value_new_numeric(value_get_numeric(v1)/value_get_numeric(v2));
-    else if(op=='%')
-      result = value_new_numeric(
-          (gint)value_get_numeric(v1)%(gint)value_get_numeric(v2));
-    else if(op=='&')
-      result = value_new_numeric(value_get_numeric(v1)&&value_get_numeric(v2));
-    else if(op=='|')
-      result = value_new_numeric(value_get_numeric(v1)||value_get_numeric(v2));
-    else if(op=='<')
-      result = value_new_numeric(value_get_numeric(v1)<value_get_numeric(v2));
-    else if(op=='>')
-      result = value_new_numeric(value_get_numeric(v1)>value_get_numeric(v2));
-    else if(op=='=')
-      result = value_new_numeric(value_get_numeric(v1)==value_get_numeric(v2));
-    else if(op=='!')
-      result = value_new_numeric(value_get_numeric(v1)!=value_get_numeric(v2));
-    else
-      result= value_na;
+  v2 = vm_pop(vm);
+  v1 = vm_pop(vm);
 
-    if((op=='<' || op=='>') && *(vm->ip+1)=='=')
+  if(value_is_na(v1) && value_is_na(v2))
+    vm_push(vm, value_na);
+  else if(value_is_array(v1) || value_is_array(v2))
+    vm_push(vm, value_array_concat(v1, v2));
+  else if(value_like_string(v1) && value_like_string(v2))
+  {
+    if(op == EXPR_OP_ADD)
     {
-      vm->ip++;
-      result.value.numeric = value_get_numeric(result) ||
-        (value_get_numeric(v1)==value_get_numeric(v2));
+      vm_push(vm, vm_op_concat(v1, v2));
+      value_free(v2);
+      return;
     }
+    else if(op == EXPR_OP_EQ)
+      vm_push(vm, value_new_numeric(
+          !g_ascii_strcasecmp(value_get_string(v1), value_get_string(v2))));
+    else if(op == EXPR_OP_NE)
+      vm_push(vm, value_new_numeric(
+          !!g_ascii_strcasecmp(value_get_string(v1), value_get_string(v2))));
+    else
+      vm_push(vm, value_na);
   }
+  else if(value_like_numeric(v1) && value_like_numeric(v2))
+    vm_push(vm, value_new_numeric(vm_op_numeric(op, value_get_numeric(v1),
+            value_get_numeric(v2))));
+  else
+    vm_push(vm, value_na);
 
-  vm_push(vm, result);
   value_free(v1);
   value_free(v2);
-  g_ptr_array_remove_index(vm->pstack, vm->pstack->len-1);
+}
+
+static void vm_op_unary ( vm_t *vm, guint8 op )
+{
+  value_t v1;
+
+  v1 = vm->stack->data[vm->stack->len-1];
+  if(op == EXPR_OP_NOT && value_is_numeric(v1))
+    v1.value.numeric = !v1.value.numeric;
+  else if(op == EXPR_OP_NEG && value_like_numeric(v1))
+    v1 = value_new_numeric(-value_get_numeric(v1));
+  else
+  {
+    value_free(v1);
+    v1 = value_na;
+  }
+  vm->stack->data[vm->stack->len-1] = v1;
+}
+
+static void vm_memo_free ( vm_memo_t *memo )
+{
+  gint i;
+
+  for(i=0; i<memo->np; i++)
+    value_free(memo->params[i]);
+  g_free(memo->params);
+  value_free(memo->result);
+  g_free(memo);
+}
+
+/* deterministic builtins are memoised per call site (instruction pointer)
+ * of an expression, the last parameters and result are kept */
+static gboolean vm_memo_lookup ( vm_t *vm, vm_function_t *func,
+    value_t params[], guint8 np, value_t *result )
+{
+  vm_memo_t *memo;
+  gint i;
+
+  if(!vm->expr || !vm->expr->memo ||
+      !(memo = g_hash_table_lookup(vm->expr->memo, vm->ip)) ||
+      memo->func != func || memo->np != np)
+    return FALSE;
+
+  for(i=0; i<np; i++)
+    if(!value_equal(params[i], memo->params[i]))
+      return FALSE;
 
+  *result = value_dup(memo->result);
   return TRUE;
 }
 
+static void vm_memo_store ( vm_t *vm, vm_function_t *func, value_t params[],
+    guint8 np, value_t result )
+{
+  vm_memo_t *memo;
+  gint i;
+
+  if(!vm->expr || value_is_array(result))
+    return;
+  for(i=0; i<np; i++)
+    if(value_is_array(params[i]))
+      return;
+
+  if(!vm->expr->memo)
+    vm->expr->memo = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+        NULL, (GDestroyNotify)vm_memo_free);
+
+  memo = g_malloc(sizeof(vm_memo_t));
+  memo->func = func;
+  memo->np = np;
+  memo->params = g_malloc(sizeof(value_t)*MAX(1, np));
+  for(i=0; i<np; i++)
+    memo->params[i] = value_persist(value_dup(params[i]));
+  memo->result = value_share(value_persist(value_dup(result)));
+  g_hash_table_replace(vm->expr->memo, vm->ip, memo);
+}
+
 value_t vm_function_call ( vm_t *vm, GBytes *code, guint8 np )
 {
   value_t v1;
@@ -142,10 +317,24 @@ value_t vm_function_call ( vm_t *vm, GBytes *code, guint8 np )
   return v1;
 }
 
+/* get the code of the last parameter of the function being called */
+GBytes *vm_param_code ( vm_t *vm )
+{
+  gint alen;
+
+  if(*vm->ip != EXPR_OP_FUNCTION)
+    return NULL;
+  memcpy(&alen, vm->ip+sizeof(gpointer)+2, sizeof(gint));
+  if(alen<=0 || alen > vm->ip - vm->code)
+    return NULL;
+
+  return g_bytes_new(vm->ip - alen, alen);
+}
+
 static gboolean vm_function ( vm_t *vm )
 {
   vm_function_t *func;
-  value_t v1, result;
+  value_t v1, result, *params;
   guint8 np = *(vm->ip+1);
   gint i;
 
@@ -155,8 +344,14 @@ static gboolean vm_function ( vm_t *vm )
   memcpy(&func, vm->ip+2, sizeof(gpointer));
   if(!(func->flags & VM_FUNC_USERDEFINED) && func->ptr.function)
   {
-    result = func->ptr.function(vm,
-        (value_t *)vm->stack->data + vm->stack->len - np, np);
+    params = vm->stack->data + vm->stack->len - np;
+    if(!(func->flags & VM_FUNC_DETERMINISTIC))
+      result = func->ptr.function(vm, params, np);
+    else if(!vm_memo_lookup(vm, func, params, np, &result))
+    {
+      result = func->ptr.function(vm, params, np);
+      vm_memo_store(vm, func, params, np, result);
+    }
     if(vm->expr)
       vm->expr->vstate |= !(func->flags & VM_FUNC_DETERMINISTIC);
   }
@@ -165,12 +360,8 @@ static gboolean vm_function ( vm_t *vm )
   else
     result = value_na;
 
-  expr_dep_add(func->name, vm->expr);
-  if(np>1)
-    g_ptr_array_remove_range(vm->pstack, vm->pstack->len-np+1, np-1);
-  else if(!np)
-    g_ptr_array_add(vm->pstack, vm->ip);
-  vm->ip += sizeof(gpointer)+1;
+  expr_dep_add_once(func->name, vm->expr);
+  vm->ip += EXPR_FUNCTION_LEN - 1;
 
   for(i=0; i<np; i++)
   {
@@ -183,18 +374,18 @@ static gboolean vm_function ( vm_t *vm )
   return TRUE;
 }
 
-static void vm_variable ( vm_t *vm )
+static void vm_scanvar ( vm_t *vm )
 {
   value_t value;
-  gchar *name;
+  ScanSlot *slot;
 
-  memcpy(&name, vm->ip+1, sizeof(gpointer));
-  value = scanner_get_value(name, !vm->use_cached, vm->expr);
-  expr_dep_add(name, vm->expr);
+  memcpy(&slot, vm->ip+1, sizeof(gpointer));
+  expr_dep_add_once(slot->name, vm->expr);
+  value = scanner_slot_value(slot, vm->ip[sizeof(gpointer)+1],
+      vm->ip[sizeof(gpointer)+2], !vm->use_cached, vm->expr);
 
   vm_push(vm, value);
-  g_ptr_array_add(vm->pstack, vm->ip);
-  vm->ip += sizeof(gpointer);
+  vm->ip += sizeof(gpointer)+2;
 }
 
 static void vm_local ( vm_t *vm )
@@ -207,7 +398,6 @@ static void vm_local ( vm_t *vm )
   v1 = value_dup(((value_t *)(vm->stack->data))[vm->fp+pos-1]);
 
   vm_push(vm, v1);
-  g_ptr_array_add(vm->pstack, vm->ip);
   vm->ip += sizeof(guint16);
 }
 
@@ -219,7 +409,8 @@ static void vm_assign ( vm_t *vm )
   memcpy(&pos, vm->ip+1, sizeof(guint16));
 
   v1 = vm_pop(vm);
-  ((value_t *)(vm->stack->data))[vm->fp+pos-1] = value_dup(v1);
+  value_free(vm->stack->data[vm->fp+pos-1]);
+  vm->stack->data[vm->fp+pos-1] = value_share(v1);
   vm->ip += sizeof(guint16)*1;
 }
 
@@ -227,7 +418,6 @@ static void vm_immediate ( vm_t *vm )
 {
   value_t v1;
 
-  g_ptr_array_add(vm->pstack, vm->ip);
   if(*(vm->ip+1) != EXPR_TYPE_STRING)
   {
     memcpy(&v1, vm->ip+1, sizeof(value_t));
@@ -235,9 +425,8 @@ static void vm_immediate ( vm_t *vm )
   }
   else
   {
-    v1.type = EXPR_TYPE_STRING;
-    v1.value.string = g_strdup((gchar *)vm->ip+2);
-    vm->ip += strlen(value_get_string(v1))+2;
+    v1 = value_new_string_static(vm->ip+2);
+    vm->ip += strlen(v1.value.string)+2;
   }
   vm_push(vm, v1);
 }
@@ -252,138 +441,159 @@ static value_t vm_run ( vm_t *vm, guint8 np )
   if(IS_TASKBAR_ITEM(vm->widget))
     vm->win = flow_item_get_source(vm->widget);
 
-  if(!vm->stack)
-    vm->stack = g_array_sized_new(FALSE, FALSE, sizeof(value_t),
-        MAX(1, vm->expr? vm->expr->stack_depth : 1));
-  if(!vm->pstack)
-    vm->pstack = g_ptr_array_sized_new(
-        MAX(1, vm->expr? vm->expr->stack_depth : 1));
-
   saved_fp = vm->fp;
   vm->fp = vm->stack->len - np;
 
   for(vm->ip = vm->code; (vm->ip-vm->code)<vm->len; vm->ip++)
-  {
-    //g_message("stack %d, op %d", vm->stack->len, *vm->ip);
-    if(*vm->ip == EXPR_OP_IMMEDIATE)
-      vm_immediate(vm);
-    else if(*vm->ip == EXPR_OP_CACHED)
-      vm->use_cached = *(++vm->ip);
-    else if(*vm->ip == EXPR_OP_VARIABLE)
-      vm_variable(vm);
-    else if(*vm->ip == EXPR_OP_LOCAL)
-      vm_local(vm);
-    else if(*vm->ip == EXPR_OP_ASSIGN)
-      vm_assign(vm);
-    else if(*vm->ip == EXPR_OP_RETURN)
-      break;
-    else if(*vm->ip == EXPR_OP_FUNCTION)
-      vm_function(vm);
-    else if(*vm->ip == EXPR_OP_JMP)
-    {
-      memcpy(&jmp, vm->ip+1, sizeof(gint));
-      vm->ip+=jmp+sizeof(gint);
-    }
-    else if(*vm->ip == EXPR_OP_JZ)
+    switch(*vm->ip)
     {
-      g_ptr_array_remove_index(vm->pstack, vm->pstack->len-1);
-      v1 = vm_pop(vm);
-      if(!value_is_numeric(v1) || !v1.value.numeric)
-      {
+      case EXPR_OP_IMMEDIATE:
+        vm_immediate(vm);
+        break;
+      case EXPR_OP_CACHED:
+        vm->use_cached = *(++vm->ip);
+        break;
+      case EXPR_OP_SCANVAR:
+        vm_scanvar(vm);
+        break;
+      case EXPR_OP_LOCAL:
+        vm_local(vm);
+        break;
+      case EXPR_OP_ASSIGN:
+        vm_assign(vm);
+        break;
+      case EXPR_OP_FUNCTION:
+        vm_function(vm);
+        break;
+      case EXPR_OP_JMP:
         memcpy(&jmp, vm->ip+1, sizeof(gint));
-        vm->ip+=jmp;
-      }
-      value_free(v1);
-      vm->ip+=sizeof(gint);
-    }
-    else if (*vm->ip == EXPR_OP_DISCARD)
-    {
-      v1 = vm_pop(vm);
-      value_free(v1);
-    }
-    else if(*vm->ip == '!')
-    {
-      v1 = vm_pop(vm);
-      if(value_is_numeric(v1))
-        v1.value.numeric = !v1.value.numeric;
-      else
-      {
+        vm->ip+=jmp+sizeof(gint);
+        break;
+      case EXPR_OP_JZ:
+        v1 = vm_pop(vm);
+        if(!value_is_numeric(v1) || !v1.value.numeric)
+        {
+          memcpy(&jmp, vm->ip+1, sizeof(gint));
+          vm->ip+=jmp;
+        }
         value_free(v1);
-        v1 = value_na;
-      }
-      vm_push(vm, v1);
-    }
-    else if(!vm_op_binary(vm))
-    {
-      g_message("invalid op");
-      break;
+        vm->ip+=sizeof(gint);
+        break;
+      case EXPR_OP_DISCARD:
+        v1 = vm_pop(vm);
+        value_free(v1);
+        break;
+      case EXPR_OP_ADD:
+      case EXPR_OP_SUB:
+      case EXPR_OP_MUL:
+      case EXPR_OP_DIV:
+      case EXPR_OP_MOD:
+      case EXPR_OP_AND:
+      case EXPR_OP_OR:
+      case EXPR_OP_LT:
+      case EXPR_OP_GT:
+      case EXPR_OP_LE:
+      case EXPR_OP_GE:
+      case EXPR_OP_EQ:
+      case EXPR_OP_NE:
+        if(vm->stack->len < 2)
+          goto invalid;
+        vm_op_binary(vm, *vm->ip);
+        break;
+      case EXPR_OP_NOT:
+      case EXPR_OP_NEG:
+        if(!vm->stack->len)
+          goto invalid;
+        vm_op_unary(vm, *vm->ip);
+        break;
+      case EXPR_OP_RETURN:
+        vm->fp = saved_fp;
+        return value_na;
+      default:
+        goto invalid;
     }
-  }
 
   vm->fp = saved_fp;
+  return value_na;
+
+invalid:
+  g_message("invalid op");
+  vm->fp = saved_fp;
 
   return value_na;
 }
 
-static value_t vm_free ( vm_t *vm )
+static void vm_init ( vm_t *vm, guint8 *code, gsize len,
+    expr_cache_t *expr )
 {
-  value_t v1 = value_na;
-
-  if(vm->stack)
-  {
-    if(vm->stack->len>1)
-      g_message("stack too long");
+  memset(vm, 0, sizeof(vm_t));
+  vm->code = code;
+  vm->len = len;
+  vm->expr = expr;
+  vm->stack = vm_stack_acquire(expr? expr->stack_depth : 1);
+}
 
-    vm_stack_unwind(vm, 1);
-    v1 = vm->stack->len? vm_pop(vm) : value_na;
+static value_t vm_free ( vm_t *vm )
+{
+  value_t v1;
 
-    if(vm->expr)
-      vm->expr->stack_depth = MAX(vm->expr->stack_depth, vm->max_stack);
+  if(vm->stack->len>1)
+    g_message("stack too long");
 
-    g_array_unref(vm->stack);
-  }
+  vm_stack_unwind(vm, 1);
+  v1 = vm_pop(vm);
 
-  if(vm->pstack)
-    g_ptr_array_free(vm->pstack, TRUE);
+  if(vm->expr)
+    vm->expr->stack_depth = MAX(vm->expr->stack_depth, vm->max_stack);
 
-  g_free(vm);
+  vm_stack_release();
 
   return v1;
 }
 
 value_t vm_expr_eval ( expr_cache_t *expr )
 {
-  vm_t *vm;
+  vm_t vm;
 
-  vm = g_malloc0(sizeof(vm_t));
+  vm_init(&vm, (gpointer)g_bytes_get_data(expr->code, NULL),
+      g_bytes_get_size(expr->code), expr);
+  vm.widget = expr->widget;
+  vm.event = expr->event;
+  vm.wstate = action_state_build(vm.widget, vm.win);
 
-  vm->code = (gpointer)g_bytes_get_data(expr->code, &vm->len);
-  vm->widget = expr->widget;
-  vm->event = expr->event;
-  vm->expr = expr;
-  vm->wstate = action_state_build(vm->widget, vm->win);
+  vm_run(&vm, 0);
+
+  return vm_free(&vm);
+}
+
+/* evaluate a fragment of constant code (used by the compiler to fold
+ * constant expressions) */
+value_t vm_code_eval ( guint8 *code, gsize len )
+{
+  vm_t vm;
 
-  vm_run(vm, 0);
+  vm_init(&vm, code, len, NULL);
+  vm_run(&vm, 0);
 
-  return vm_free(vm);
+  return vm_free(&vm);
 }
 
 void vm_run_action ( GBytes *code, GtkWidget *widget, GdkEvent *event,
     window_t *win, guint16 *state )
 {
   value_t v1;
-  vm_t *vm;
+  vm_t vm;
 
   if(!code)
     return;
-  vm = g_malloc0(sizeof(vm_t));
-  vm->code = (gpointer)g_bytes_get_data(code, &vm->len);
-  vm->widget = widget;
-  vm->event = event;
-  vm->wstate = state? *state : action_state_build(vm->widget, vm->win);
-
-  vm_run(vm, 0);
-  v1 = vm_free(vm);
+  vm_init(&vm, (gpointer)g_bytes_get_data(code, NULL),
+      g_bytes_get_size(code), NULL);
+  vm.widget = widget;
+  vm.event = event;
+  vm.wstate = state? *state : action_state_build(vm.widget, vm.win);
+
+  vm_run(&vm, 0);
+  v1 = vm_free(&vm);
   value_free(v1);
 }
 
@@ -11,26 +11,50 @@ enum expr_instruction_t {
   EXPR_OP_JZ,
   EXPR_OP_JMP,
   EXPR_OP_CACHED,
-  EXPR_OP_VARIABLE,
+  EXPR_OP_SCANVAR,
   EXPR_OP_FUNCTION,
   EXPR_OP_DISCARD,
   EXPR_OP_LOCAL,
   EXPR_OP_ASSIGN,
-  EXPR_OP_RETURN
+  EXPR_OP_RETURN,
+  EXPR_OP_ADD,
+  EXPR_OP_SUB,
+  EXPR_OP_MUL,
+  EXPR_OP_DIV,
+  EXPR_OP_MOD,
+  EXPR_OP_AND,
+  EXPR_OP_OR,
+  EXPR_OP_LT,
+  EXPR_OP_GT,
+  EXPR_OP_LE,
+  EXPR_OP_GE,
+  EXPR_OP_EQ,
+  EXPR_OP_NE,
+  EXPR_OP_NOT,
+  EXPR_OP_NEG
 };
 
+/* EXPR_OP_FUNCTION: op, np, function pointer and length of the code of the
+ * last parameter */
+#define EXPR_FUNCTION_LEN (sizeof(gpointer)+sizeof(gint)+2)
+
 enum vm_func_flags_t {
-  VM_FUNC_DETERMINISTIC,
-  VM_FUNC_USERDEFINED
+  VM_FUNC_DETERMINISTIC = 1,
+  VM_FUNC_USERDEFINED = 2
 };
 
+typedef struct {
+  value_t *data;
+  gsize len;
+  gsize size;
+} vm_stack_t;
+
 typedef struct {
   guint8 *ip;
   guint8 *code;
   gsize len;
   gsize fp;
-  GArray *stack;
-  GPtrArray *pstack;
+  vm_stack_t *stack;
   gint max_stack;
   gboolean use_cached;
   guint16 wstate;
@@ -65,7 +89,9 @@ gboolean parser_function_parse( GScanner *scanner );
 const gchar *parser_identifier_lookup ( gchar *identifier );
 
 value_t vm_expr_eval ( expr_cache_t *expr );
+value_t vm_code_eval ( guint8 *code, gsize len );
 value_t vm_function_call ( vm_t *vm, GBytes *code, guint8 np );
+GBytes *vm_param_code ( vm_t *vm );
 void vm_run_action ( GBytes *code, GtkWidget *w, GdkEvent *e, window_t *win,
     guint16 *s);
 void vm_run_user_defined ( gchar *action, GtkWidget *widget, GdkEvent *event,